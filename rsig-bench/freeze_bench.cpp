@@ -0,0 +1,80 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <rsig/rsig.h>
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr auto event_count = 1000000;
+
+    template <typename Fun>
+    double measure(int threads, Fun fun)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (auto t = 0; t < threads; t++)
+        {
+            workers.emplace_back(fun);
+        }
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        auto time = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::nano>(time).count() / (event_count * threads);
+    }
+
+    double emit_time(bool frozen, int threads)
+    {
+        // the observer does not synchronize, so only the emit is measured
+        std::atomic<long long> sum = 0;
+        rsig::signal<int> signal;
+        signal.connect([&] (int v) { sum.store(sum.load(std::memory_order_relaxed) + v, std::memory_order_relaxed); });
+        if (frozen)
+        {
+            signal.freeze();
+        }
+        return measure(threads, [&] {
+            for (auto i = 0; i < event_count; i++)
+            {
+                signal.emit(i);
+            }
+        });
+    }
+}
+
+int main()
+{
+    auto hardware = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+    for (auto threads : {1, hardware})
+    {
+        std::cout << "emit, " << threads << " threads:        " << emit_time(false, threads) << " ns/event\n"
+                  << "frozen emit, " << threads << " threads: " << emit_time(true, threads) << " ns/event\n";
+    }
+    return 0;
+}
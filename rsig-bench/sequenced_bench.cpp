@@ -0,0 +1,76 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <rsig/sequenced_signal.h>
+
+#include <chrono>
+#include <iostream>
+
+namespace
+{
+    constexpr auto event_count = 1000000;
+    constexpr auto tick_length = 1000;
+
+    template <typename Fun>
+    double measure(Fun fun)
+    {
+        auto start = std::chrono::steady_clock::now();
+        fun();
+        auto time = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::nano>(time).count() / event_count;
+    }
+}
+
+int main()
+{
+    auto sum = 0ll;
+
+    rsig::signal<int> plain;
+    plain.connect([&] (int v) { sum += v; });
+    auto plain_time = measure([&] {
+        for (auto i = 0; i < event_count; i++)
+        {
+            plain.emit(i);
+        }
+    });
+
+    rsig::sequenced_signal<int> sequenced;
+    sequenced.connect([&] (int v) { sum += v; });
+    auto& producer = sequenced.get_producer(0);
+    auto sequenced_time = measure([&] {
+        for (auto i = 0; i < event_count; i++)
+        {
+            producer.emit(i);
+            if ((i + 1) % tick_length == 0)
+            {
+                sequenced.advance();
+            }
+        }
+        sequenced.advance();
+    });
+
+    std::cout << "emit:            " << plain_time << " ns/event\n"
+              << "sequenced emit:  " << sequenced_time << " ns/event\n"
+              << "checksum:        " << sum << "\n";
+    return 0;
+}
@@ -0,0 +1,65 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <gtest/gtest.h>
+#include <rsig/codec.h>
+
+TEST(codec, varint)
+{
+    for (auto value : {std::uint64_t{0}, std::uint64_t{127}, std::uint64_t{128}, std::uint64_t{300}, ~std::uint64_t{0}})
+    {
+        rsig::byte_buffer out;
+        rsig::encode_varint(out, value);
+        rsig::byte_reader in(out.data(), out.size());
+        EXPECT_EQ(value, rsig::decode_varint(in));
+        EXPECT_EQ(0u, in.remaining());
+    }
+
+    rsig::byte_buffer small;
+    rsig::encode_varint(small, 42);
+    EXPECT_EQ(1u, small.size());
+}
+
+TEST(codec, args_roundtrip)
+{
+    rsig::byte_buffer out;
+    rsig::encode_args(out, 42, std::string("hello"), 1.5, std::vector<int>{1, 2, 3});
+
+    rsig::byte_reader in(out.data(), out.size());
+    auto [i, s, d, v] = rsig::decode_args<int, std::string, double, std::vector<int>>(in);
+    EXPECT_EQ(42, i);
+    EXPECT_EQ("hello", s);
+    EXPECT_EQ(1.5, d);
+    EXPECT_EQ(std::vector<int>({1, 2, 3}), v);
+    EXPECT_EQ(0u, in.remaining());
+}
+
+TEST(codec, truncated)
+{
+    rsig::byte_buffer out;
+    rsig::encode_args(out, std::string("hello"));
+    out.pop_back();
+
+    rsig::byte_reader in(out.data(), out.size());
+    EXPECT_THROW(rsig::decode_args<std::string>(in), std::runtime_error);
+}
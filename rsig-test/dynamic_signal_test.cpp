@@ -0,0 +1,96 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <gtest/gtest.h>
+#include <rsig/dynamic_signal.h>
+
+using namespace std::string_literals;
+
+TEST(dynamic_signal, typed_emit)
+{
+    auto sig = rsig::dynamic_signal({rsig::value_type::integer, rsig::value_type::string});
+
+    auto sum  = std::int64_t{0};
+    auto text = std::string{};
+    sig.connect<std::int64_t, std::string>([&] (std::int64_t i, std::string s) {
+        sum  += i;
+        text += s;
+    });
+
+    EXPECT_EQ(1u, sig.emit(std::int64_t{2}, "a"s));
+    EXPECT_EQ(1u, sig.emit(std::int64_t{3}, "b"s));
+    EXPECT_EQ(5, sum);
+    EXPECT_EQ("ab", text);
+}
+
+TEST(dynamic_signal, dynamic_emit)
+{
+    auto sig = rsig::dynamic_signal({rsig::value_type::number, rsig::value_type::boolean});
+
+    auto typed   = 0.0;
+    auto dynamic = std::vector<rsig::value>{};
+    sig.connect<double, bool>([&] (double d, bool b) {
+        typed += b ? d : 0.0;
+    });
+    sig.connect_dynamic([&] (const std::vector<rsig::value>& args) {
+        dynamic = args;
+    });
+
+    EXPECT_EQ(2u, sig.emit_dynamic({1.5, true}));
+    EXPECT_EQ(1.5, typed);
+    ASSERT_EQ(2u, dynamic.size());
+    EXPECT_EQ(1.5, std::get<double>(dynamic[0]));
+    EXPECT_EQ(true, std::get<bool>(dynamic[1]));
+
+    EXPECT_EQ(2u, sig.emit(2.5, false));
+    EXPECT_EQ(1.5, typed);
+    EXPECT_EQ(2.5, std::get<double>(dynamic[0]));
+    EXPECT_EQ(false, std::get<bool>(dynamic[1]));
+}
+
+TEST(dynamic_signal, disconnect)
+{
+    auto sig = rsig::dynamic_signal({rsig::value_type::integer});
+
+    auto count = 0;
+    auto c1 = sig.connect<std::int64_t>([&] (std::int64_t) { count++; });
+    auto c2 = sig.connect_dynamic([&] (const std::vector<rsig::value>&) { count++; });
+
+    EXPECT_EQ(2u, sig.emit(std::int64_t{1}));
+    sig.disconnect(c1);
+    EXPECT_EQ(1u, sig.emit(std::int64_t{1}));
+    sig.disconnect(c2);
+    EXPECT_EQ(0u, sig.emit_dynamic({std::int64_t{1}}));
+    EXPECT_EQ(3, count);
+}
+
+TEST(dynamic_signal, schema_mismatch)
+{
+    auto sig = rsig::dynamic_signal({rsig::value_type::integer, rsig::value_type::string});
+
+    EXPECT_THROW(sig.connect<double>([] (double) {}), std::invalid_argument);
+    EXPECT_THROW(sig.emit(std::int64_t{1}), std::invalid_argument);
+    EXPECT_THROW(sig.emit_dynamic({std::int64_t{1}}), std::invalid_argument);
+    EXPECT_THROW(sig.emit_dynamic({"a"s, std::int64_t{1}}), std::invalid_argument);
+    EXPECT_NO_THROW(sig.emit_dynamic({std::int64_t{1}, "a"s}));
+}
@@ -0,0 +1,232 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <gtest/gtest.h>
+#include <rsig/ipc_signal.h>
+
+#include <algorithm>
+#include <array>
+#include <thread>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+    std::string test_name(const char* name)
+    {
+        return "/rsig-test-" + std::string(name) + "-" + std::to_string(getpid());
+    }
+
+    struct Vec2
+    {
+        float x;
+        float y;
+    };
+}
+
+TEST(ipc_signal, emit_dispatch)
+{
+    auto name = test_name("emit");
+    rsig::ipc_signal<int, Vec2> sender(name, 16);
+    rsig::ipc_signal<int, Vec2> receiver(name, 16);
+    rsig::ipc_signal<int, Vec2>::unlink(name);
+
+    auto sum = 0;
+    auto pos = Vec2{};
+    receiver.connect([&] (auto v, auto p) {
+        sum += v;
+        pos = p;
+    });
+
+    sender.emit(1, {1.0f, 2.0f});
+    sender.emit(2, {3.0f, 4.0f});
+
+    EXPECT_EQ(2u, receiver.dispatch());
+    EXPECT_EQ(0u, receiver.dispatch());
+    EXPECT_EQ(3, sum);
+    EXPECT_EQ(3.0f, pos.x);
+    EXPECT_EQ(4.0f, pos.y);
+    EXPECT_EQ(0u, receiver.lost());
+}
+
+TEST(ipc_signal, overrun)
+{
+    auto name = test_name("overrun");
+    rsig::ipc_signal<int> sender(name, 4);
+    rsig::ipc_signal<int> receiver(name, 4);
+    rsig::ipc_signal<int>::unlink(name);
+
+    std::vector<int> values;
+    receiver.connect([&] (auto v) {
+        values.push_back(v);
+    });
+
+    for (auto i = 0; i < 10; i++)
+    {
+        sender.emit(i);
+    }
+
+    EXPECT_EQ(4u, receiver.dispatch());
+    EXPECT_EQ(std::vector<int>({6, 7, 8, 9}), values);
+    EXPECT_EQ(6u, receiver.lost());
+}
+
+TEST(ipc_signal, stalled_producer)
+{
+    auto name = test_name("stall");
+    rsig::ipc_signal<int> sender(name, 16, 20ms);
+    rsig::ipc_signal<int> receiver(name, 16, 20ms);
+
+    // take a ticket without writing it, like a producer that died in emit;
+    // the head counter follows ready, capacity and payload_size
+    auto fd = shm_open(name.c_str(), O_RDWR, 0600);
+    ASSERT_NE(-1, fd);
+    auto memory = mmap(nullptr, 64, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ASSERT_NE(MAP_FAILED, memory);
+    reinterpret_cast<std::atomic<std::uint64_t>*>(static_cast<unsigned char*>(memory) + 16)->fetch_add(1);
+    munmap(memory, 64);
+    close(fd);
+    rsig::ipc_signal<int>::unlink(name);
+
+    std::vector<int> values;
+    receiver.connect([&] (auto v) {
+        values.push_back(v);
+    });
+
+    sender.emit(1);
+    sender.emit(2);
+
+    EXPECT_EQ(0u, receiver.dispatch());
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(2u, receiver.wait(1000ms));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 500ms);
+    EXPECT_EQ(std::vector<int>({1, 2}), values);
+    EXPECT_EQ(1u, receiver.lost());
+}
+
+TEST(ipc_signal, concurrent_producers)
+{
+    // tickets that are a capacity apart write the same slot
+    using block = std::array<std::uint64_t, 64>;
+    auto name = test_name("producers");
+    rsig::ipc_signal<block> receiver(name, 2);
+
+    auto broken    = 0u;
+    auto delivered = std::uint64_t{0};
+    receiver.connect([&] (const auto& b) {
+        if (std::count(begin(b), end(b), b[0]) != static_cast<std::ptrdiff_t>(b.size()))
+        {
+            broken++;
+        }
+        delivered++;
+    });
+
+    constexpr auto producers = 8u;
+    constexpr auto events    = std::uint64_t{20000};
+    std::vector<std::thread> threads;
+    for (auto p = 0u; p < producers; p++)
+    {
+        threads.emplace_back([&, p] () {
+            rsig::ipc_signal<block> sender(name, 2);
+            auto b = block{};
+            for (auto i = std::uint64_t{0}; i < events; i++)
+            {
+                b.fill(p * events + i);
+                sender.emit(b);
+            }
+        });
+    }
+    for (auto i = 0; i < 1000; i++)
+    {
+        receiver.dispatch();
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    receiver.dispatch();
+    rsig::ipc_signal<block>::unlink(name);
+
+    EXPECT_EQ(0u, broken);
+    EXPECT_EQ(producers * events, delivered + receiver.lost());
+}
+
+TEST(ipc_signal, creator_died)
+{
+    auto name = test_name("died");
+    // an object that was never sized, like after a crash in the constructor
+    auto fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    ASSERT_NE(-1, fd);
+    close(fd);
+
+    EXPECT_THROW((rsig::ipc_signal<int>(name, 4, 10ms)), std::runtime_error);
+    rsig::ipc_signal<int>::unlink(name);
+}
+
+TEST(ipc_signal, layout_mismatch)
+{
+    auto name = test_name("layout");
+    rsig::ipc_signal<int> a(name, 4);
+
+    EXPECT_THROW((rsig::ipc_signal<double>(name, 4)), std::runtime_error);
+    EXPECT_THROW((rsig::ipc_signal<int>(name, 8)), std::runtime_error);
+    rsig::ipc_signal<int>::unlink(name);
+}
+
+TEST(ipc_signal, cross_process)
+{
+    auto name = test_name("fork");
+    rsig::ipc_signal<int> receiver(name, 64);
+
+    auto pid = fork();
+    ASSERT_NE(-1, pid);
+    if (pid == 0)
+    {
+        rsig::ipc_signal<int> sender(name, 64);
+        for (auto i = 1; i <= 10; i++)
+        {
+            sender.emit(i);
+        }
+        _exit(0);
+    }
+
+    auto sum   = 0;
+    auto count = 0u;
+    receiver.connect([&] (auto v) {
+        sum += v;
+    });
+    while (count < 10u)
+    {
+        count += receiver.wait(100ms);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    rsig::ipc_signal<int>::unlink(name);
+
+    EXPECT_EQ(55, sum);
+    EXPECT_EQ(0, WEXITSTATUS(status));
+}
@@ -0,0 +1,112 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <gtest/gtest.h>
+#include <rsig/journal.h>
+
+using namespace std::literals::chrono_literals;
+
+TEST(journal, record_replay)
+{
+    auto path = testing::TempDir() + "rsig-journal-record.bin";
+    {
+        rsig::signal<int, std::string> text_signal;
+        rsig::signal<float>            value_signal;
+        rsig::signal<int>              ignored_signal;
+
+        rsig::journal journal(path, 4096u);
+        journal.record(text_signal, "text");
+        journal.record(value_signal, "value");
+        journal.record(ignored_signal, "ignored");
+
+        text_signal.emit(1, "one");
+        value_signal.emit(1.5f);
+        ignored_signal.emit(3);
+        text_signal.emit(2, "two");
+
+        EXPECT_EQ(0u, journal.dropped());
+        EXPECT_LT(0u, journal.size());
+    }
+
+    rsig::signal<int, std::string> text_signal;
+    rsig::signal<float>            value_signal;
+
+    std::vector<std::string> events;
+    text_signal.connect([&] (auto i, auto s) {
+        events.push_back(std::to_string(i) + s);
+    });
+    value_signal.connect([&] (auto v) {
+        events.push_back(std::to_string(v));
+    });
+
+    rsig::journal_reader reader(path);
+    reader.bind("text", text_signal);
+    reader.bind("value", value_signal);
+
+    EXPECT_EQ(3u, reader.replay());
+    EXPECT_EQ(std::vector<std::string>({"1one", std::to_string(1.5f), "2two"}), events);
+
+    // a journal can be replayed many times
+    EXPECT_EQ(3u, reader.replay());
+    EXPECT_EQ(6u, events.size());
+}
+
+TEST(journal, replay_original_speed)
+{
+    auto path = testing::TempDir() + "rsig-journal-speed.bin";
+    {
+        rsig::signal<> tick;
+        rsig::journal journal(path, 4096u);
+        journal.record(tick, "tick");
+        tick.emit();
+        std::this_thread::sleep_for(20ms);
+        tick.emit();
+    }
+
+    rsig::signal<> tick;
+    rsig::journal_reader reader(path);
+    reader.bind("tick", tick);
+
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(2u, reader.replay(rsig::replay_speed::original));
+    EXPECT_LE(20ms, std::chrono::steady_clock::now() - start);
+}
+
+TEST(journal, full)
+{
+    auto path = testing::TempDir() + "rsig-journal-full.bin";
+    rsig::signal<std::string> text_signal;
+    rsig::journal journal(path, 256u);
+    journal.record(text_signal, "text");
+
+    for (auto i = 0; i < 10; i++)
+    {
+        text_signal.emit(std::string(40, 'x'));
+    }
+    EXPECT_LT(0u, journal.dropped());
+
+    rsig::signal<std::string> replay_signal;
+    rsig::journal_reader reader(path);
+    reader.bind("text", replay_signal);
+    EXPECT_EQ(10u - journal.dropped(), reader.replay());
+}
@@ -0,0 +1,184 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <gtest/gtest.h>
+#include <rsig/pipeline.h>
+
+#include <atomic>
+#include <future>
+#include <string>
+
+TEST(pipeline, stages)
+{
+    auto sum = std::atomic<int>{0};
+    {
+        rsig::pipeline p;
+        auto& parse = p.add_stage<std::string>(16, 2, 4);
+        auto& total = p.add_stage<int>(16);
+
+        parse.connect([&] (std::string s) {
+            total.emit(std::stoi(s));
+        });
+        total.connect([&] (int v) {
+            sum += v;
+        });
+
+        for (auto i = 1; i <= 100; i++)
+        {
+            parse.emit(std::to_string(i));
+        }
+        while (total.get_stats().processed != 100)
+        {
+            std::this_thread::yield();
+        }
+        EXPECT_EQ(100u, parse.get_stats().processed);
+    }
+    EXPECT_EQ(5050, sum.load());
+}
+
+TEST(pipeline, try_emit_full)
+{
+    auto release = std::promise<void>{};
+    auto blocked = release.get_future().share();
+    auto started = std::promise<void>{};
+
+    rsig::stage<int> s(1);
+    s.connect([&] (int v) {
+        if (v == 0)
+        {
+            started.set_value();
+            blocked.wait();
+        }
+    });
+
+    EXPECT_TRUE(s.try_emit(0));
+    started.get_future().wait();
+    EXPECT_TRUE(s.try_emit(1));
+    EXPECT_FALSE(s.try_emit(2));
+    EXPECT_EQ(1u, s.get_stats().depth);
+    release.set_value();
+}
+
+TEST(pipeline, adjust)
+{
+    auto release = std::promise<void>{};
+    auto blocked = release.get_future().share();
+
+    rsig::pipeline p(std::chrono::hours(1));
+    auto& s = p.add_stage<int>(64, 1, 3);
+    s.connect([&] (int) {
+        blocked.wait();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    s.emit(0);
+
+    // no service time is known yet, the stage does not grow
+    for (auto i = 0; i < 10; i++)
+    {
+        s.emit(i);
+    }
+    p.adjust();
+    EXPECT_EQ(1u, s.get_stats().workers);
+
+    release.set_value();
+    while (s.get_stats().depth != 0)
+    {
+        std::this_thread::yield();
+    }
+    p.adjust();
+    EXPECT_EQ(1u, s.get_stats().workers);
+
+    s.resize(3);
+    EXPECT_EQ(3u, s.get_stats().workers);
+    p.adjust();
+    EXPECT_EQ(2u, s.get_stats().workers);
+}
+
+TEST(pipeline, adjust_grow)
+{
+    auto release = std::promise<void>{};
+    auto blocked = release.get_future().share();
+
+    rsig::pipeline p(std::chrono::milliseconds(5));
+    auto& s = p.add_stage<int>(64, 1, 3);
+    s.connect([&] (int v) {
+        if (v != 0)
+        {
+            blocked.wait();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    });
+
+    // the first event gives the stage a service time
+    s.emit(0);
+    while (s.get_stats().processed == 0)
+    {
+        std::this_thread::yield();
+    }
+
+    // the backlog takes longer than the interval, the stage grows to max
+    for (auto i = 0; i < 10; i++)
+    {
+        s.emit(1);
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (s.get_stats().workers < 3u && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(3u, s.get_stats().workers);
+    p.adjust();
+    EXPECT_EQ(3u, s.get_stats().workers);
+
+    // once the queue is empty it shrinks back to min
+    release.set_value();
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while ((s.get_stats().workers > 1u || s.get_stats().processed < 11u) && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(1u, s.get_stats().workers);
+    EXPECT_EQ(11u, s.get_stats().processed);
+}
+
+TEST(pipeline, trace_context)
+{
+    auto trace = std::atomic<std::uint64_t>{0};
+    {
+        // first emits into second, so second must outlive it
+        rsig::stage<int> second;
+        rsig::stage<int> first;
+        first.connect([&] (int v) { second.emit(v); });
+        second.connect([&] (int) { trace = rsig::current_trace().trace_id; });
+
+        {
+            rsig::trace_scope scope({9, 1, std::chrono::steady_clock::now()});
+            first.emit(1);
+        }
+        while (second.get_stats().processed != 1)
+        {
+            std::this_thread::yield();
+        }
+    }
+    EXPECT_EQ(9u, trace.load());
+}
@@ -0,0 +1,51 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <gtest/gtest.h>
+#include <rsig/posix_signal.h>
+
+#include <poll.h>
+
+TEST(posix_signal, dispatch)
+{
+    rsig::posix_signal signals = {SIGUSR1, SIGUSR2};
+
+    std::vector<int> received;
+    signals.get_signal().connect([&] (auto signum) {
+        received.push_back(signum);
+    });
+
+    EXPECT_EQ(0u, signals.dispatch());
+
+    pthread_kill(pthread_self(), SIGUSR2);
+    pthread_kill(pthread_self(), SIGUSR1);
+    pthread_kill(pthread_self(), SIGUSR2);
+
+    pollfd pfd = {signals.fd(), POLLIN, 0};
+    ASSERT_EQ(1, poll(&pfd, 1, 1000));
+
+    EXPECT_EQ(2u, signals.dispatch());
+    ASSERT_EQ(2u, received.size());
+    EXPECT_NE(received[0], received[1]);
+    EXPECT_EQ(0u, signals.dispatch());
+}
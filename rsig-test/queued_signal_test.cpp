@@ -0,0 +1,142 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <gtest/gtest.h>
+#include <rsig/queued_signal.h>
+
+#include <thread>
+
+#include <poll.h>
+#include <sys/epoll.h>
+
+TEST(queued_signal, drain_batch)
+{
+    rsig::queued_signal<int, std::string> queued;
+
+    std::vector<std::string> events;
+    queued.connect([&] (auto i, auto s) {
+        events.push_back(std::to_string(i) + s);
+    });
+
+    pollfd pfd = {queued.fd(), POLLIN, 0};
+    EXPECT_EQ(0, poll(&pfd, 1, 0));
+
+    queued.emit(1, "a");
+    queued.emit(2, "b");
+    EXPECT_TRUE(events.empty());
+    EXPECT_EQ(1, poll(&pfd, 1, 0));
+
+    EXPECT_EQ(2u, queued.drain());
+    EXPECT_EQ(std::vector<std::string>({"1a", "2b"}), events);
+    EXPECT_EQ(0, poll(&pfd, 1, 0));
+    EXPECT_EQ(0u, queued.drain());
+}
+
+TEST(queued_signal, throwing_observer)
+{
+    rsig::queued_signal<int> queued;
+
+    std::vector<int> events;
+    queued.connect([&] (auto i) {
+        events.push_back(i);
+        if (i == 2)
+        {
+            throw std::runtime_error("observer failed");
+        }
+    });
+
+    queued.emit(1);
+    queued.emit(2);
+    queued.emit(3);
+    EXPECT_THROW(queued.drain(), std::runtime_error);
+    EXPECT_EQ(std::vector<int>({1, 2}), events);
+
+    // the event after the throw is still queued and signaled
+    pollfd pfd = {queued.fd(), POLLIN, 0};
+    EXPECT_EQ(1, poll(&pfd, 1, 0));
+
+    queued.emit(4);
+    EXPECT_EQ(2u, queued.drain());
+    queued.emit(5);
+    EXPECT_EQ(1u, queued.drain());
+    EXPECT_EQ(std::vector<int>({1, 2, 3, 4, 5}), events);
+    EXPECT_EQ(0, poll(&pfd, 1, 0));
+}
+
+TEST(queued_signal, epoll_loop)
+{
+    rsig::signal<int>        source;
+    rsig::queued_signal<int> queued;
+    source.connect(rsig::mem_fun(&queued, &rsig::queued_signal<int>::emit));
+
+    auto sum = 0;
+    queued.connect([&] (auto v) {
+        sum += v;
+    });
+
+    auto ep = epoll_create1(EPOLL_CLOEXEC);
+    ASSERT_NE(-1, ep);
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ASSERT_EQ(0, epoll_ctl(ep, EPOLL_CTL_ADD, queued.fd(), &ev));
+
+    std::thread producer([&] () {
+        for (auto i = 1; i <= 1000; i++)
+        {
+            source.emit(i);
+        }
+    });
+
+    auto count = 0u;
+    while (count < 1000u)
+    {
+        epoll_event out = {};
+        if (epoll_wait(ep, &out, 1, 1000) == 1)
+        {
+            count += queued.drain();
+        }
+    }
+    producer.join();
+    close(ep);
+
+    EXPECT_EQ(500500, sum);
+}
+
+TEST(queued_signal, trace_context)
+{
+    rsig::queued_signal<int> queued;
+
+    auto seen = std::vector<std::uint64_t>{};
+    queued.connect([&] (auto) {
+        seen.push_back(rsig::current_trace().trace_id);
+    });
+
+    {
+        rsig::trace_scope scope({7, 1, std::chrono::steady_clock::now()});
+        queued.emit(1);
+    }
+    queued.emit(2);
+
+    std::thread([&] { queued.drain(); }).join();
+    EXPECT_EQ((std::vector<std::uint64_t>{7, 0}), seen);
+}
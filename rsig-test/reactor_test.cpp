@@ -0,0 +1,124 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <gtest/gtest.h>
+#include <rsig/reactor.h>
+
+#include <thread>
+
+#include <sys/socket.h>
+
+using namespace std::literals::chrono_literals;
+
+TEST(reactor, watch_fd)
+{
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+    rsig::reactor reactor;
+    std::string   received;
+    reactor.watch(fds[1]).connect([&] (auto events) {
+        EXPECT_TRUE(events & EPOLLIN);
+        char buffer[16];
+        auto n = read(fds[1], buffer, sizeof(buffer));
+        received.append(buffer, static_cast<size_t>(n));
+    });
+
+    EXPECT_EQ(0u, reactor.run_once(0ms));
+    ASSERT_EQ(5, write(fds[0], "hello", 5));
+    EXPECT_EQ(1u, reactor.run_once(1000ms));
+    EXPECT_EQ("hello", received);
+
+    reactor.unwatch(fds[1]);
+    ASSERT_EQ(5, write(fds[0], "hello", 5));
+    EXPECT_EQ(0u, reactor.run_once(0ms));
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(reactor, timer)
+{
+    rsig::reactor reactor;
+
+    auto ticks = std::uint64_t{0};
+    auto& timer = reactor.add_timer(1ms);
+    timer.connect([&] (auto expirations) {
+        ticks += expirations;
+        if (ticks >= 5u)
+        {
+            // removing from inside the observer is fine
+            reactor.remove_timer(timer);
+            reactor.stop();
+        }
+    });
+
+    reactor.run();
+    EXPECT_LE(5u, ticks);
+    EXPECT_THROW(reactor.remove_timer(timer), std::invalid_argument);
+}
+
+TEST(reactor, stop_before_run)
+{
+    rsig::reactor reactor;
+
+    reactor.stop();
+    reactor.run();
+
+    // the stop was used up, the next run waits for its own stop
+    auto ran = false;
+    auto& timer = reactor.add_timer(1ms);
+    timer.connect([&] (auto) {
+        ran = true;
+        reactor.stop();
+    });
+    reactor.run();
+    EXPECT_TRUE(ran);
+}
+
+TEST(reactor, queued_signal)
+{
+    rsig::reactor            reactor;
+    rsig::queued_signal<int> queued;
+    reactor.watch(queued);
+
+    auto sum = 0;
+    queued.connect([&] (auto v) {
+        sum += v;
+        if (v == 100)
+        {
+            reactor.stop();
+        }
+    });
+
+    std::thread producer([&] () {
+        for (auto i = 1; i <= 100; i++)
+        {
+            queued.emit(i);
+        }
+    });
+
+    reactor.run();
+    producer.join();
+    EXPECT_EQ(5050, sum);
+}
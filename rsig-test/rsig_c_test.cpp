@@ -0,0 +1,82 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <gtest/gtest.h>
+#include <rsig/rsig_c.h>
+
+namespace
+{
+    struct Event
+    {
+        int value;
+    };
+
+    void accumulate(void* context, const void* event)
+    {
+        *static_cast<int*>(context) += static_cast<const Event*>(event)->value;
+    }
+}
+
+TEST(rsig_c, connect_emit_disconnect)
+{
+    auto sig = rsig_signal_create();
+    ASSERT_NE(nullptr, sig);
+
+    auto sum1 = 0;
+    auto sum2 = 0;
+    rsig_connection c1, c2;
+    ASSERT_EQ(RSIG_OK, rsig_signal_connect(sig, &accumulate, &sum1, &c1));
+    ASSERT_EQ(RSIG_OK, rsig_signal_connect(sig, &accumulate, &sum2, &c2));
+
+    auto event = Event{21};
+    size_t count = 0;
+    EXPECT_EQ(RSIG_OK, rsig_signal_emit(sig, &event, &count));
+    EXPECT_EQ(2u, count);
+    EXPECT_EQ(21, sum1);
+    EXPECT_EQ(21, sum2);
+
+    EXPECT_EQ(RSIG_OK, rsig_signal_disconnect(sig, c1));
+    EXPECT_EQ(RSIG_NOT_FOUND, rsig_signal_disconnect(sig, c1));
+    EXPECT_EQ(RSIG_OK, rsig_signal_emit(sig, &event, nullptr));
+    EXPECT_EQ(21, sum1);
+    EXPECT_EQ(42, sum2);
+
+    rsig_signal_destroy(sig);
+}
+
+TEST(rsig_c, invalid_arguments)
+{
+    auto sig1 = rsig_signal_create();
+    auto sig2 = rsig_signal_create();
+
+    auto sum = 0;
+    rsig_connection c;
+    EXPECT_EQ(RSIG_INVALID_ARGUMENT, rsig_signal_connect(sig1, nullptr, &sum, &c));
+    EXPECT_EQ(RSIG_INVALID_ARGUMENT, rsig_signal_connect(nullptr, &accumulate, &sum, &c));
+    ASSERT_EQ(RSIG_OK, rsig_signal_connect(sig1, &accumulate, &sum, &c));
+    EXPECT_EQ(RSIG_INVALID_ARGUMENT, rsig_signal_disconnect(sig2, c));
+    EXPECT_EQ(RSIG_INVALID_ARGUMENT, rsig_signal_emit(nullptr, nullptr, nullptr));
+
+    rsig_signal_destroy(sig1);
+    rsig_signal_destroy(sig2);
+}
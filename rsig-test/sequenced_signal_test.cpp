@@ -0,0 +1,138 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <gtest/gtest.h>
+#include <rsig/sequenced_signal.h>
+
+#include <atomic>
+#include <thread>
+
+TEST(sequenced_signal, canonical_order)
+{
+    rsig::sequenced_signal<int> sig;
+
+    auto seen = std::vector<int>{};
+    sig.connect([&] (int v) { seen.push_back(v); });
+
+    auto& p2 = sig.get_producer(2);
+    auto& p1 = sig.get_producer(1);
+    p2.emit(20);
+    p1.emit(10);
+    p2.emit(21);
+    p1.emit(11);
+    EXPECT_TRUE(seen.empty());
+
+    EXPECT_EQ(0u, sig.current_tick());
+    EXPECT_EQ(4u, sig.advance());
+    EXPECT_EQ(1u, sig.current_tick());
+    EXPECT_EQ((std::vector<int>{10, 11, 20, 21}), seen);
+    EXPECT_EQ(0u, sig.advance());
+}
+
+TEST(sequenced_signal, threads)
+{
+    auto run = [] {
+        rsig::sequenced_signal<int> sig;
+
+        auto seen = std::vector<int>{};
+        sig.connect([&] (int v) { seen.push_back(v); });
+
+        for (auto tick = 0; tick < 10; tick++)
+        {
+            std::vector<std::thread> threads;
+            for (auto t = 0u; t < 4u; t++)
+            {
+                threads.emplace_back([&, t] {
+                    auto& p = sig.get_producer(t);
+                    for (auto i = 0; i < 10; i++)
+                    {
+                        p.emit(static_cast<int>(t) * 100 + i);
+                    }
+                });
+            }
+            for (auto& t : threads)
+            {
+                t.join();
+            }
+            sig.advance();
+        }
+        return seen;
+    };
+
+    auto first = run();
+    EXPECT_EQ(400u, first.size());
+    EXPECT_EQ(first, run());
+}
+
+TEST(sequenced_signal, tick_boundary)
+{
+    rsig::sequenced_signal<std::uint64_t> sig;
+
+    // an event is never dispatched before the advance that ends its tick
+    auto errors = std::atomic<int>{0};
+    auto count  = size_t{0};
+    sig.connect([&] (std::uint64_t stamped) {
+        if (stamped >= sig.current_tick())
+        {
+            errors++;
+        }
+        count++;
+    });
+
+    auto done = std::atomic<bool>{false};
+    std::thread producer([&] {
+        auto& p = sig.get_producer(0);
+        for (auto i = 0; i < 100000; i++)
+        {
+            p.emit(sig.current_tick());
+        }
+        done = true;
+    });
+    while (!done)
+    {
+        sig.advance();
+    }
+    producer.join();
+    sig.advance();
+
+    EXPECT_EQ(0, errors.load());
+    EXPECT_EQ(100000u, count);
+}
+
+TEST(sequenced_signal, trace_context)
+{
+    rsig::sequenced_signal<int> sig;
+
+    auto trace = std::uint64_t{0};
+    sig.connect([&] (int) { trace = rsig::current_trace().trace_id; });
+
+    std::thread producer([&] {
+        rsig::trace_scope scope({42, 1, std::chrono::steady_clock::now()});
+        sig.get_producer(0).emit(1);
+    });
+    producer.join();
+
+    EXPECT_EQ(1u, sig.advance());
+    EXPECT_EQ(42u, trace);
+    EXPECT_EQ(0u, rsig::current_trace().trace_id);
+}
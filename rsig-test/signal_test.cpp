@@ -28,6 +28,7 @@
 #include <future>
 #include <thread>
 #include <chrono>
+#include <iterator>
 
 using namespace std::literals::chrono_literals;
 
@@ -223,4 +224,667 @@ TEST(signal, life_time)
 
     running = false;
     f.get();
-}
\ No newline at end of file
+}
+TEST(signal, masked_emit)
+{
+    rsig::signal<int> int_signal;
+
+    auto input   = 0u;
+    auto network = 0u;
+    auto all     = 0u;
+    int_signal.connect([&] (auto) { input++; }, 0x1);
+    int_signal.connect([&] (auto) { network++; }, 0x2);
+    int_signal.connect([&] (auto) { all++; });
+
+    auto c = int_signal.emit(0x1, 42);
+    EXPECT_EQ(2u, c);
+    EXPECT_EQ(1u, input);
+    EXPECT_EQ(0u, network);
+    EXPECT_EQ(1u, all);
+
+    c = int_signal.emit(0x4, 42);
+    EXPECT_EQ(1u, c);
+    EXPECT_EQ(2u, all);
+
+    c = int_signal.emit(42);
+    EXPECT_EQ(3u, c);
+    EXPECT_EQ(2u, input);
+    EXPECT_EQ(1u, network);
+}
+
+TEST(signal, masked_emit_many)
+{
+    rsig::signal<> void_signal;
+
+    std::vector<unsigned int> calls(37);
+    for (auto i = 0u; i < calls.size(); i++)
+    {
+        void_signal.connect([&calls, i] () { calls[i]++; }, std::uint64_t{1} << (i % 3));
+    }
+
+    auto c = void_signal.emit(0x2);
+    EXPECT_EQ(12u, c);
+    for (auto i = 0u; i < calls.size(); i++)
+    {
+        EXPECT_EQ(i % 3 == 1 ? 1u : 0u, calls[i]);
+    }
+}
+
+TEST(signal, block_observer)
+{
+    rsig::signal<> void_signal;
+
+    auto count1 = 0u;
+    auto count2 = 0u;
+    auto c1 = void_signal.connect([&] () { count1++; });
+    void_signal.connect([&] () { count2++; });
+
+    void_signal.block(c1);
+    EXPECT_EQ(1u, void_signal.emit());
+    EXPECT_EQ(0u, count1);
+    EXPECT_EQ(1u, count2);
+
+    void_signal.unblock(c1);
+    EXPECT_EQ(2u, void_signal.emit());
+    EXPECT_EQ(1u, count1);
+    EXPECT_EQ(2u, count2);
+
+    // still the same connection
+    void_signal.disconnect(c1);
+    EXPECT_EQ(1u, void_signal.emit());
+}
+
+TEST(signal, block_group)
+{
+    rsig::signal<int> int_signal;
+    rsig::signal<> void_signal;
+    rsig::group    ui;
+
+    auto count = 0u;
+    int_signal.connect([&] (auto) { count++; }, ui);
+    int_signal.connect([&] (auto) { count++; }, ui, 0x1);
+    void_signal.connect([&] () { count++; }, ui);
+    int_signal.connect([&] (auto) { count += 10; });
+
+    ui.block();
+    EXPECT_TRUE(ui.is_blocked());
+    EXPECT_EQ(1u, int_signal.emit(1));
+    EXPECT_EQ(0u, void_signal.emit());
+    EXPECT_EQ(10u, count);
+
+    ui.unblock();
+    EXPECT_EQ(3u, int_signal.emit(1));
+    EXPECT_EQ(3u, int_signal.emit(0x1, 1));
+    EXPECT_EQ(1u, void_signal.emit());
+    EXPECT_EQ(35u, count);
+}
+
+struct Tracked
+{
+    unsigned int count = 0;
+
+    void increment(int v)
+    {
+        count += v;
+    }
+};
+
+TEST(signal, tracked_observer)
+{
+    rsig::signal<int> int_signal;
+
+    auto tracked = std::make_shared<Tracked>();
+    auto c = int_signal.connect(std::weak_ptr<Tracked>(tracked), &Tracked::increment);
+
+    EXPECT_EQ(1u, int_signal.emit(2));
+    EXPECT_EQ(2u, tracked->count);
+
+    tracked.reset();
+    EXPECT_EQ(0u, int_signal.emit(2));
+    // the observer was removed by emit
+    EXPECT_THROW(int_signal.disconnect(c), std::runtime_error);
+}
+
+TEST(signal, tracked_observer_expired)
+{
+    rsig::signal<int> int_signal;
+
+    auto tracked = std::make_shared<Tracked>();
+    auto weak    = std::weak_ptr<Tracked>(tracked);
+    tracked.reset();
+
+    EXPECT_THROW(int_signal.connect(weak, &Tracked::increment), std::invalid_argument);
+}
+
+TEST(signal, connect_once)
+{
+    rsig::signal<> void_signal;
+
+    auto once   = 0u;
+    auto always = 0u;
+    auto c = void_signal.connect_once([&] () { once++; });
+    void_signal.connect([&] () { always++; });
+
+    EXPECT_EQ(2u, void_signal.emit());
+    EXPECT_EQ(1u, void_signal.emit());
+    EXPECT_EQ(1u, once);
+    EXPECT_EQ(2u, always);
+    EXPECT_THROW(void_signal.disconnect(c), std::runtime_error);
+}
+
+TEST(signal, connect_once_masked)
+{
+    rsig::signal<int> int_signal;
+
+    auto value = 0;
+    int_signal.connect_once([&] (auto v) { value = v; }, 0x2);
+
+    EXPECT_EQ(0u, int_signal.emit(0x1, 1));
+    EXPECT_EQ(1u, int_signal.emit(0x2, 2));
+    EXPECT_EQ(0u, int_signal.emit(0x2, 3));
+    EXPECT_EQ(2, value);
+}
+
+#ifdef RSIG_STOP_TOKEN
+TEST(signal, stop_token)
+{
+    rsig::signal<> void_signal;
+    std::stop_source source;
+
+    auto count = 0u;
+    auto c = void_signal.connect([&] () { count++; }, source.get_token());
+
+    EXPECT_EQ(1u, void_signal.emit());
+    source.request_stop();
+    EXPECT_EQ(0u, void_signal.emit());
+    EXPECT_EQ(1u, count);
+    EXPECT_THROW(void_signal.disconnect(c), std::runtime_error);
+}
+
+TEST(signal, stop_token_jthread)
+{
+    rsig::signal<int> int_signal;
+    std::atomic<int>  sum = 0;
+
+    {
+        std::jthread worker([&] (std::stop_token token) {
+            int_signal.connect([&] (auto v) { sum += v; }, token);
+            while (!token.stop_requested())
+            {
+                std::this_thread::sleep_for(1ms);
+            }
+        });
+        while (int_signal.emit(1) == 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    EXPECT_EQ(0u, int_signal.emit(1));
+    EXPECT_EQ(1, sum);
+}
+#endif
+
+void add_to(void* context, int value)
+{
+    *static_cast<int*>(context) += value;
+}
+
+TEST(signal, function_pointer_observer)
+{
+    rsig::signal<int> int_signal;
+
+    auto sum1 = 0;
+    auto sum2 = 0;
+    auto c = int_signal.connect(&add_to, &sum1);
+    int_signal.connect([&] (auto v) { sum2 += v; });
+
+    EXPECT_EQ(2u, int_signal.emit(21));
+    int_signal.disconnect(c);
+    EXPECT_EQ(1u, int_signal.emit(21));
+    EXPECT_EQ(21, sum1);
+    EXPECT_EQ(42, sum2);
+}
+
+TEST(signal, forward)
+{
+    rsig::signal<int> a;
+    rsig::signal<int> b;
+
+    auto sum_a = 0;
+    auto sum_b = 0;
+    a.connect([&] (auto v) { sum_a += v; });
+    b.connect([&] (auto v) {
+        sum_b += v;
+        // a is not locked while b is emitted
+        a.connect([] (auto) {});
+    });
+
+    auto c = rsig::forward(a, b);
+    EXPECT_EQ(2u, a.emit(1));
+    EXPECT_EQ(1u, b.emit(2));
+    EXPECT_EQ(1, sum_a);
+    EXPECT_EQ(3, sum_b);
+
+    // the observer of a and the two connected by b
+    a.disconnect(c);
+    EXPECT_EQ(3u, a.emit(4));
+    EXPECT_EQ(5, sum_a);
+    EXPECT_EQ(3, sum_b);
+
+    EXPECT_THROW(a.disconnect(c), std::runtime_error);
+    EXPECT_THROW(rsig::forward(a, a), std::invalid_argument);
+}
+
+TEST(signal, forward_masked)
+{
+    rsig::signal<int> a;
+    rsig::signal<int> b;
+
+    auto sum = 0;
+    b.connect([&] (auto v) { sum += v; }, 0x1);
+    b.connect([&] (auto v) { sum += 10 * v; }, 0x4);
+    rsig::forward(a, b, 0x3);
+
+    EXPECT_EQ(1u, a.emit(0x1, 1));
+    EXPECT_EQ(0u, a.emit(0x4, 1));
+    EXPECT_EQ(2u, a.emit(1));
+    EXPECT_EQ(12, sum);
+}
+
+TEST(signal, freeze)
+{
+    rsig::signal<int> int_signal;
+
+    auto sum = 0;
+    auto c = int_signal.connect([&] (auto v) { sum += v; });
+    int_signal.connect([&] (auto v) { sum += 10 * v; }, 0x2);
+
+    int_signal.freeze();
+    EXPECT_TRUE(int_signal.is_frozen());
+    EXPECT_EQ(2u, int_signal.emit(1));
+    EXPECT_EQ(1u, int_signal.emit(0x4, 1));
+    EXPECT_EQ(12, sum);
+
+    int_signal.block(c);
+    EXPECT_TRUE(int_signal.is_frozen());
+    EXPECT_EQ(1u, int_signal.emit(1));
+    int_signal.unblock(c);
+    EXPECT_EQ(22, sum);
+
+    int_signal.disconnect(c);
+    EXPECT_FALSE(int_signal.is_frozen());
+    EXPECT_EQ(1u, int_signal.emit(1));
+    EXPECT_EQ(32, sum);
+
+    auto stats = int_signal.get_stats();
+    EXPECT_EQ(1u, stats.freezes);
+    EXPECT_EQ(1u, stats.thaws);
+}
+
+TEST(signal, freeze_connect_in_observer)
+{
+    rsig::signal<int> int_signal;
+
+    auto count = 0;
+    int_signal.connect_once([&] (auto) {
+        int_signal.connect([&] (auto) { count++; });
+    });
+
+    int_signal.freeze();
+    EXPECT_EQ(1u, int_signal.emit(1));
+    EXPECT_FALSE(int_signal.is_frozen());
+    EXPECT_EQ(1u, int_signal.emit(1));
+    EXPECT_EQ(1, count);
+}
+
+TEST(signal, freeze_once_concurrent)
+{
+    rsig::signal<int> int_signal;
+
+    auto calls = std::atomic<int>{0};
+    int_signal.connect_once([&] (auto) { calls++; });
+    int_signal.freeze();
+
+    std::vector<std::thread> threads;
+    for (auto i = 0; i < 4; i++)
+    {
+        threads.emplace_back([&] {
+            for (auto j = 0; j < 100; j++)
+            {
+                int_signal.emit(j);
+            }
+        });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    EXPECT_EQ(1, calls.load());
+}
+
+TEST(signal, freeze_disconnect_waits)
+{
+    rsig::signal<int> int_signal;
+
+    auto entered  = std::promise<void>{};
+    auto release  = std::promise<void>{};
+    auto released = release.get_future().share();
+    auto calling  = std::atomic<bool>{false};
+    auto c = int_signal.connect([&] (auto v) {
+        if (v == 1)
+        {
+            calling = true;
+            entered.set_value();
+            released.wait();
+            std::this_thread::sleep_for(10ms);
+            calling = false;
+        }
+    });
+    int_signal.freeze();
+
+    std::thread emitter([&] { int_signal.emit(1); });
+    entered.get_future().wait();
+
+    std::thread releaser([&] { release.set_value(); });
+    int_signal.disconnect(c);
+    // the frozen emit on the other thread was waited for
+    EXPECT_FALSE(calling.load());
+    EXPECT_EQ(0u, int_signal.emit(2));
+
+    emitter.join();
+    releaser.join();
+}
+
+TEST(signal, freeze_disconnect_in_observer)
+{
+    rsig::signal<int> int_signal;
+
+    auto count = 0;
+    rsig::connection second;
+    int_signal.connect([&] (auto) {
+        int_signal.disconnect(second);
+    });
+    second = int_signal.connect([&] (auto) { count++; });
+
+    int_signal.freeze();
+    EXPECT_EQ(1u, int_signal.emit(1));
+    EXPECT_FALSE(int_signal.is_frozen());
+    EXPECT_EQ(0, count);
+}
+
+TEST(signal, freeze_nested_emit)
+{
+    rsig::signal<int> int_signal;
+
+    // deeper than the reads a thread tells apart
+    auto calls = 0;
+    int_signal.connect([&] (auto depth) {
+        calls++;
+        if (depth < 40)
+        {
+            int_signal.emit(depth + 1);
+        }
+        else
+        {
+            int_signal.connect([] (auto) {});
+        }
+    });
+
+    int_signal.freeze();
+    EXPECT_EQ(1u, int_signal.emit(1));
+    EXPECT_EQ(40, calls);
+    EXPECT_FALSE(int_signal.is_frozen());
+}
+
+TEST(signal, freeze_once_thaw_concurrent)
+{
+    for (auto round = 0; round < 20; round++)
+    {
+        rsig::signal<int> int_signal;
+
+        auto calls = std::atomic<int>{0};
+        int_signal.connect_once([&] (auto) { calls++; });
+        int_signal.freeze();
+
+        std::vector<std::thread> threads;
+        for (auto i = 0; i < 4; i++)
+        {
+            threads.emplace_back([&] {
+                for (auto j = 0; j < 100; j++)
+                {
+                    int_signal.emit(j);
+                }
+            });
+        }
+        // thawing while the frozen emits run must not lose the call
+        auto c = int_signal.connect([] (auto) {});
+        int_signal.disconnect(c);
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+        EXPECT_EQ(1, calls.load());
+    }
+}
+
+TEST(signal, emit_combining)
+{
+    rsig::signal<int> int_signal;
+
+    auto sum = std::atomic<int>{0};
+    int_signal.connect([&] (auto v) { sum += v; });
+    int_signal.connect([&] (auto v) { sum += v; });
+
+    std::vector<std::thread> threads;
+    for (auto i = 0; i < 4; i++)
+    {
+        threads.emplace_back([&] {
+            for (auto j = 0; j < 1000; j++)
+            {
+                EXPECT_EQ(2u, int_signal.emit_combining(1));
+            }
+        });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    EXPECT_EQ(8000, sum.load());
+}
+
+TEST(signal, emit_combining_exception)
+{
+    rsig::signal<int> int_signal;
+
+    int_signal.connect([] (auto v) {
+        if (v < 0)
+        {
+            throw std::runtime_error("negative");
+        }
+    });
+
+    EXPECT_EQ(1u, int_signal.emit_combining(1));
+    EXPECT_THROW(int_signal.emit_combining(-1), std::runtime_error);
+    EXPECT_EQ(1u, int_signal.emit_combining(1));
+}
+
+TEST(signal, trace_context)
+{
+    rsig::signal<int> outer;
+    rsig::signal<int> inner;
+
+    auto seen = std::vector<std::uint64_t>{};
+    outer.connect([&] (auto v) {
+        seen.push_back(rsig::current_trace().trace_id);
+        inner.emit(v);
+    });
+    inner.connect([&] (auto) {
+        seen.push_back(rsig::current_trace().trace_id);
+    });
+
+    {
+        rsig::trace_scope scope({42, 1, std::chrono::steady_clock::now()});
+        outer.emit(1);
+        EXPECT_EQ(1u, outer.emit_combining(1));
+    }
+    EXPECT_EQ(0u, rsig::current_trace().trace_id);
+    outer.emit(1);
+
+    EXPECT_EQ((std::vector<std::uint64_t>{42, 42, 42, 42, 0, 0}), seen);
+}
+
+TEST(signal, replace)
+{
+    rsig::signal<int> int_signal;
+
+    auto calls = std::vector<int>{};
+    auto c1 = int_signal.connect([&] (auto) { calls.push_back(1); });
+    int_signal.connect([&] (auto) { calls.push_back(2); });
+
+    int_signal.replace(c1, [&] (auto) { calls.push_back(3); });
+    EXPECT_EQ(2u, int_signal.emit(0));
+    EXPECT_EQ((std::vector<int>{3, 2}), calls);
+
+    int_signal.block(c1);
+    int_signal.freeze();
+    int_signal.replace(c1, [&] (auto) { calls.push_back(4); });
+    EXPECT_FALSE(int_signal.is_frozen());
+    EXPECT_EQ(1u, int_signal.emit(0));
+    int_signal.unblock(c1);
+    EXPECT_EQ(2u, int_signal.emit(0));
+    EXPECT_EQ((std::vector<int>{3, 2, 2, 4, 2}), calls);
+
+    EXPECT_THROW(int_signal.replace(c1, nullptr), std::invalid_argument);
+    int_signal.disconnect(c1);
+    EXPECT_THROW(int_signal.replace(c1, [] (auto) {}), std::runtime_error);
+}
+
+TEST(signal, destroy_while_emitting)
+{
+    auto int_signal = std::make_unique<rsig::signal<int>>();
+    auto raw        = int_signal.get();
+
+    auto entered  = std::promise<void>{};
+    auto release  = std::promise<void>{};
+    auto finished = std::atomic<bool>{false};
+    auto released = release.get_future().share();
+    raw->connect([&] (auto) {
+        entered.set_value();
+        released.wait();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        finished = true;
+    });
+
+    std::thread emitter([raw] { raw->emit(1); });
+    entered.get_future().wait();
+    std::thread releaser([&] { release.set_value(); });
+
+    int_signal.reset();
+    EXPECT_TRUE(finished.load());
+
+    emitter.join();
+    releaser.join();
+}
+
+TEST(signal, destroy_while_emitting_frozen)
+{
+    auto int_signal = std::make_unique<rsig::signal<int>>();
+    auto raw        = int_signal.get();
+
+    auto entered  = std::promise<void>{};
+    auto release  = std::promise<void>{};
+    auto finished = std::atomic<bool>{false};
+    auto released = release.get_future().share();
+    raw->connect([&] (auto) {
+        entered.set_value();
+        released.wait();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        finished = true;
+    });
+    raw->freeze();
+
+    std::thread emitter([raw] { raw->emit(1); });
+    entered.get_future().wait();
+    std::thread releaser([&] { release.set_value(); });
+
+    int_signal.reset();
+    EXPECT_TRUE(finished.load());
+
+    emitter.join();
+    releaser.join();
+}
+
+TEST(signal, destroy_with_blocked_emitter)
+{
+    auto int_signal = std::make_unique<rsig::signal<int>>();
+    auto raw        = int_signal.get();
+
+    auto entered  = std::promise<void>{};
+    auto release  = std::promise<void>{};
+    auto seconds  = std::atomic<int>{0};
+    auto released = release.get_future().share();
+    raw->connect([&] (auto v) {
+        if (v == 1)
+        {
+            entered.set_value();
+            released.wait();
+        }
+        else
+        {
+            seconds++;
+        }
+    });
+
+    std::thread first([raw] { raw->emit(1); });
+    entered.get_future().wait();
+    // the second emitter blocks on the lock the first one holds
+    auto second_count = size_t{99};
+    std::thread second([&] { second_count = raw->emit(2); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::thread releaser([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        release.set_value();
+    });
+
+    int_signal.reset();
+
+    first.join();
+    second.join();
+    releaser.join();
+    // the second emit either got the lock before the destructor, or found
+    // the signal closed
+    EXPECT_EQ(static_cast<size_t>(seconds.load()), second_count);
+    EXPECT_GE(1u, second_count);
+}
+
+TEST(signal, connect_bulk)
+{
+    rsig::signal<int> int_signal;
+
+    auto calls = std::vector<int>{};
+    int_signal.connect([&] (auto) { calls.push_back(0); });
+
+    auto funs = std::vector<std::function<void (int)>>{};
+    for (auto i = 1; i <= 3; i++)
+    {
+        funs.push_back([&calls, i] (auto) { calls.push_back(i); });
+    }
+
+    auto connections = std::vector<rsig::connection>{};
+    int_signal.connect_bulk(funs, std::back_inserter(connections));
+    ASSERT_EQ(3u, connections.size());
+
+    EXPECT_EQ(4u, int_signal.emit(0));
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3}), calls);
+
+    int_signal.disconnect(connections[1]);
+    calls.clear();
+    EXPECT_EQ(3u, int_signal.emit(0));
+    EXPECT_EQ((std::vector<int>{0, 1, 3}), calls);
+
+    funs.push_back(nullptr);
+    EXPECT_THROW(int_signal.connect_bulk(funs, std::back_inserter(connections)), std::invalid_argument);
+    EXPECT_EQ(3u, connections.size());
+    EXPECT_EQ(3u, int_signal.emit(0));
+}
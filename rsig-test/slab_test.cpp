@@ -0,0 +1,87 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <gtest/gtest.h>
+#include <rsig/slab.h>
+
+#include <string>
+#include <thread>
+
+TEST(slab, emit_and_recycle)
+{
+    rsig::slab_pool<std::string> pool(2);
+    rsig::signal<const rsig::slab_ptr<std::string>&> sig;
+
+    auto length = size_t{0};
+    sig.connect([&] (const rsig::slab_ptr<std::string>& body) {
+        length += body->size();
+    });
+
+    for (auto i = 0; i < 10; i++)
+    {
+        rsig::emit_slab(sig, pool, [] (std::string& body) {
+            body.assign(4096, 'x');
+        });
+    }
+    EXPECT_EQ(40960u, length);
+    EXPECT_EQ(2u, pool.capacity());
+    EXPECT_EQ(2u, pool.available());
+}
+
+TEST(slab, retained)
+{
+    rsig::slab_pool<std::string> pool;
+    rsig::signal<const rsig::slab_ptr<std::string>&> sig;
+
+    auto kept = std::vector<rsig::slab_ptr<std::string>>{};
+    sig.connect([&] (const rsig::slab_ptr<std::string>& body) {
+        kept.push_back(body);
+    });
+
+    sig.emit(pool.make("a"));
+    sig.emit(pool.make("b"));
+    EXPECT_EQ(pool.capacity() - 2, pool.available());
+    ASSERT_EQ(2u, kept.size());
+    EXPECT_EQ("a", *kept[0]);
+    EXPECT_EQ("b", *kept[1]);
+
+    auto copy = kept[0];
+    kept.clear();
+    EXPECT_EQ(pool.capacity() - 1, pool.available());
+    EXPECT_EQ("a", *copy);
+    copy.reset();
+    EXPECT_FALSE(copy);
+    EXPECT_EQ(pool.capacity(), pool.available());
+}
+
+TEST(slab, release_on_other_thread)
+{
+    rsig::slab_pool<int> pool(1);
+
+    auto slab = pool.make(42);
+    EXPECT_EQ(0u, pool.available());
+    std::thread([s = std::move(slab)] () mutable {
+        EXPECT_EQ(42, *s);
+    }).join();
+    EXPECT_EQ(1u, pool.available());
+}
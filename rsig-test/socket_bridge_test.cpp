@@ -0,0 +1,161 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <gtest/gtest.h>
+#include <rsig/socket_bridge.h>
+
+#include <sys/wait.h>
+
+TEST(socket_bridge, batched_forward)
+{
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds));
+
+    rsig::signal<int, std::string> source;
+    rsig::signal<int, std::string> mirror;
+
+    std::vector<std::string> received;
+    mirror.connect([&] (auto i, auto s) {
+        received.push_back(std::to_string(i) + s);
+    });
+
+    {
+        rsig::socket_sender<int, std::string> sender(source, fds[0], 1024u);
+        rsig::socket_receiver<int, std::string> receiver(fds[1], mirror);
+
+        source.emit(1, "a");
+        source.emit(2, "b");
+        // below the batch size, nothing was written yet
+        EXPECT_EQ(0u, receiver.receive());
+
+        sender.flush();
+        EXPECT_EQ(2u, receiver.receive());
+        EXPECT_EQ(std::vector<std::string>({"1a", "2b"}), received);
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(socket_bridge, throwing_observer)
+{
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds));
+
+    rsig::signal<int> source;
+    rsig::signal<int> mirror;
+
+    std::vector<int> received;
+    mirror.connect([&] (auto i) {
+        received.push_back(i);
+        if (i == 1)
+        {
+            throw std::runtime_error("observer failed");
+        }
+    });
+
+    {
+        rsig::socket_sender<int> sender(source, fds[0], 1024u);
+        rsig::socket_receiver<int> receiver(fds[1], mirror);
+
+        source.emit(1);
+        source.emit(2);
+        sender.flush();
+
+        EXPECT_THROW(receiver.receive(), std::runtime_error);
+        // the second frame is emitted without new data and the first is not repeated
+        EXPECT_EQ(1u, receiver.receive());
+        EXPECT_EQ(0u, receiver.receive());
+        EXPECT_EQ(std::vector<int>({1, 2}), received);
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(socket_bridge, send_failure)
+{
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    close(fds[1]);
+
+    rsig::signal<int> source;
+    {
+        rsig::socket_sender<int> sender(source, fds[0], 1u);
+
+        // the failed write is not thrown into the emitting thread
+        EXPECT_NO_THROW(source.emit(1));
+        EXPECT_NO_THROW(source.emit(2));
+        EXPECT_THROW(sender.flush(), std::system_error);
+    }
+
+    close(fds[0]);
+}
+
+TEST(socket_bridge, cross_process)
+{
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+    auto pid = fork();
+    ASSERT_NE(-1, pid);
+    if (pid == 0)
+    {
+        close(fds[1]);
+        rsig::signal<unsigned int, std::string> source;
+        {
+            rsig::socket_sender<unsigned int, std::string> sender(source, fds[0], 512u);
+            for (auto i = 0u; i < 1000u; i++)
+            {
+                source.emit(i, std::string(i % 17, 'x'));
+            }
+        }
+        close(fds[0]);
+        _exit(0);
+    }
+    close(fds[0]);
+
+    rsig::signal<unsigned int, std::string> mirror;
+    auto count  = 0u;
+    auto errors = 0u;
+    mirror.connect([&] (auto i, auto s) {
+        if (i != count || s != std::string(i % 17, 'x'))
+        {
+            errors++;
+        }
+        count++;
+    });
+
+    rsig::socket_receiver<unsigned int, std::string> receiver(fds[1], mirror);
+    while (!receiver.is_closed())
+    {
+        receiver.receive();
+    }
+    close(fds[1]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    EXPECT_EQ(0, WEXITSTATUS(status));
+    EXPECT_EQ(1000u, count);
+    EXPECT_EQ(0u, errors);
+}
@@ -0,0 +1,130 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <limits>
+
+#include <gtest/gtest.h>
+#include <rsig/spatial_signal.h>
+
+TEST(spatial_signal, region_observe)
+{
+    rsig::spatial_signal<int, int> click_signal(10.0f);
+
+    auto left  = 0u;
+    auto right = 0u;
+    click_signal.connect({{0.0f, 0.0f}, {50.0f, 100.0f}}, [&] (auto, auto) { left++; });
+    click_signal.connect({{50.0f, 0.0f}, {100.0f, 100.0f}}, [&] (auto, auto) { right++; });
+
+    EXPECT_EQ(1u, click_signal.emit({25.0f, 25.0f}, 1, 2));
+    EXPECT_EQ(1u, click_signal.emit({75.0f, 25.0f}, 1, 2));
+    EXPECT_EQ(1u, click_signal.emit({50.0f, 25.0f}, 1, 2));
+    EXPECT_EQ(0u, click_signal.emit({150.0f, 25.0f}, 1, 2));
+    EXPECT_EQ(0u, click_signal.emit({-5.0f, 25.0f}, 1, 2));
+
+    EXPECT_EQ(1u, left);
+    EXPECT_EQ(2u, right);
+}
+
+TEST(spatial_signal, overlapping_regions)
+{
+    rsig::spatial_signal<> void_signal(10.0f);
+
+    std::vector<int> order;
+    void_signal.connect({{0.0f, 0.0f}, {100.0f, 100.0f}}, [&] () { order.push_back(1); });
+    void_signal.connect({{5.0f, 5.0f}, {15.0f, 15.0f}}, [&] () { order.push_back(2); });
+
+    EXPECT_EQ(2u, void_signal.emit({12.0f, 12.0f}));
+    EXPECT_EQ(1u, void_signal.emit({2.0f, 2.0f}));
+    EXPECT_EQ(std::vector<int>({1, 2, 1}), order);
+}
+
+TEST(spatial_signal, move)
+{
+    rsig::spatial_signal<> void_signal(10.0f);
+
+    auto count = 0u;
+    auto c = void_signal.connect({{0.0f, 0.0f}, {10.0f, 10.0f}}, [&] () { count++; });
+
+    EXPECT_EQ(1u, void_signal.emit({5.0f, 5.0f}));
+    void_signal.move(c, {{-30.0f, -30.0f}, {-20.0f, -20.0f}});
+    EXPECT_EQ(0u, void_signal.emit({5.0f, 5.0f}));
+    EXPECT_EQ(1u, void_signal.emit({-25.0f, -25.0f}));
+    EXPECT_EQ(2u, count);
+}
+
+TEST(spatial_signal, unobserve)
+{
+    rsig::spatial_signal<> void_signal;
+
+    auto count = 0u;
+    auto c = void_signal.connect({{0.0f, 0.0f}, {200.0f, 200.0f}}, [&] () { count++; });
+    void_signal.disconnect(c);
+
+    EXPECT_EQ(0u, void_signal.emit({150.0f, 150.0f}));
+    EXPECT_EQ(0u, count);
+    EXPECT_THROW(void_signal.disconnect(c), std::runtime_error);
+}
+
+TEST(spatial_signal, non_finite)
+{
+    rsig::spatial_signal<> void_signal(10.0f);
+
+    auto inf = std::numeric_limits<float>::infinity();
+    auto nan = std::numeric_limits<float>::quiet_NaN();
+    EXPECT_THROW(void_signal.connect({{-inf, 0.0f}, {10.0f, 10.0f}}, [] () {}), std::invalid_argument);
+    EXPECT_THROW(void_signal.connect({{0.0f, 0.0f}, {10.0f, nan}}, [] () {}), std::invalid_argument);
+
+    auto count = 0u;
+    auto c = void_signal.connect({{0.0f, 0.0f}, {10.0f, 10.0f}}, [&] () { count++; });
+    EXPECT_THROW(void_signal.move(c, {{0.0f, 0.0f}, {inf, 10.0f}}), std::invalid_argument);
+
+    EXPECT_EQ(0u, void_signal.emit({nan, 5.0f}));
+    EXPECT_EQ(0u, void_signal.emit({5.0f, inf}));
+    EXPECT_EQ(1u, void_signal.emit({5.0f, 5.0f}));
+    EXPECT_EQ(1u, count);
+}
+
+TEST(spatial_signal, huge_regions)
+{
+    rsig::spatial_signal<> void_signal(64.0f);
+
+    std::vector<int> order;
+    auto a = void_signal.connect({{-1e6f, -1e6f}, {1e6f, 1e6f}}, [&] () { order.push_back(1); });
+    void_signal.connect({{0.0f, 0.0f}, {10.0f, 10.0f}}, [&] () { order.push_back(2); });
+    void_signal.connect({{-3e38f, -3e38f}, {3e38f, 3e38f}}, [&] () { order.push_back(3); });
+
+    EXPECT_EQ(3u, void_signal.emit({5.0f, 5.0f}));
+    EXPECT_EQ(2u, void_signal.emit({-5e5f, 5e5f}));
+    EXPECT_EQ(1u, void_signal.emit({2e38f, -2e38f}));
+    EXPECT_EQ(std::vector<int>({1, 2, 3, 1, 3, 3}), order);
+
+    void_signal.move(a, {{20.0f, 20.0f}, {30.0f, 30.0f}});
+    order.clear();
+    EXPECT_EQ(2u, void_signal.emit({25.0f, 25.0f}));
+    EXPECT_EQ(std::vector<int>({1, 3}), order);
+
+    void_signal.disconnect(a);
+    order.clear();
+    EXPECT_EQ(1u, void_signal.emit({25.0f, 25.0f}));
+    EXPECT_EQ(std::vector<int>({3}), order);
+}
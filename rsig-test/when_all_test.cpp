@@ -0,0 +1,94 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <gtest/gtest.h>
+#include <rsig/when_all.h>
+
+#include <string>
+#include <thread>
+
+TEST(when_all, rounds)
+{
+    rsig::signal<int> a;
+    rsig::signal<std::string, double> b;
+
+    auto rounds = std::vector<std::tuple<std::tuple<int>, std::tuple<std::string, double>>>{};
+    auto all = rsig::when_all(a, b);
+    all.connect([&] (const auto& values) {
+        rounds.push_back(values);
+    });
+
+    a.emit(1);
+    EXPECT_TRUE(rounds.empty());
+    a.emit(2);
+    b.emit("x", 0.5);
+    ASSERT_EQ(1u, rounds.size());
+    EXPECT_EQ(2, std::get<0>(std::get<0>(rounds[0])));
+    EXPECT_EQ("x", std::get<0>(std::get<1>(rounds[0])));
+
+    b.emit("y", 1.5);
+    EXPECT_EQ(1u, rounds.size());
+    a.emit(3);
+    ASSERT_EQ(2u, rounds.size());
+    EXPECT_EQ(3, std::get<0>(std::get<0>(rounds[1])));
+    EXPECT_EQ(1.5, std::get<1>(std::get<1>(rounds[1])));
+
+    a.emit(4);
+    all.reset();
+    b.emit("z", 2.5);
+    EXPECT_EQ(2u, rounds.size());
+}
+
+TEST(when_all, threads)
+{
+    rsig::signal<int> a;
+    rsig::signal<int> b;
+    rsig::signal<int> c;
+
+    auto rounds = std::atomic<int>{0};
+    auto all = rsig::when_all(a, b, c);
+    all.connect([&] (const auto&) {
+        rounds++;
+    });
+
+    for (auto i = 0; i < 100; i++)
+    {
+        std::thread ta([&] { a.emit(i); });
+        std::thread tb([&] { b.emit(i); });
+        std::thread tc([&] { c.emit(i); });
+        ta.join();
+        tb.join();
+        tc.join();
+    }
+    EXPECT_EQ(100, rounds.load());
+}
+
+TEST(when_all, disconnects_inputs)
+{
+    rsig::signal<int> a;
+    {
+        auto all = rsig::when_all(a);
+        EXPECT_EQ(1u, a.emit(1));
+    }
+    EXPECT_EQ(0u, a.emit(1));
+}
@@ -0,0 +1,187 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef _RSIG_CODEC_H_
+#define _RSIG_CODEC_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace rsig
+{
+    //! Output of the binary encoding.
+    using byte_buffer = std::vector<unsigned char>;
+
+    //! Input of the binary decoding.
+    class byte_reader
+    {
+    public:
+        byte_reader(const unsigned char* data, size_t size) noexcept
+        : pos(data), end(data + size) {}
+
+        //! Number of bytes not yet read.
+        size_t remaining() const noexcept
+        {
+            return static_cast<size_t>(end - pos);
+        }
+
+        //! Read size bytes.
+        const unsigned char* read(size_t size)
+        {
+            if (remaining() < size)
+            {
+                throw std::runtime_error("byte_reader: truncated data");
+            }
+            auto result = pos;
+            pos += size;
+            return result;
+        }
+
+    private:
+        const unsigned char* pos;
+        const unsigned char* end;
+    };
+
+    //! Write an unsigned integer in 7 bit groups.
+    inline void encode_varint(byte_buffer& out, std::uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<unsigned char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<unsigned char>(value));
+    }
+
+    //! Read an unsigned integer written by encode_varint.
+    inline std::uint64_t decode_varint(byte_reader& in)
+    {
+        auto value = std::uint64_t{0};
+        for (auto shift = 0u; shift < 64u; shift += 7u)
+        {
+            auto b = *in.read(1);
+            value |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+            if ((b & 0x80) == 0)
+            {
+                return value;
+            }
+        }
+        throw std::runtime_error("decode_varint: malformed value");
+    }
+
+    /*!
+     * Binary encoding of a value.
+     *
+     * Trivially copyable values are copied byte by byte, strings and vectors
+     * are prefixed with their length. Raw pointers are rejected at compile
+     * time. Specialize this template to send your own types through a
+     * bridge or journal.
+     */
+    template <typename T, typename Enable = void>
+    struct codec;
+
+    template <typename T>
+    struct codec<T, std::enable_if_t<std::is_trivially_copyable_v<T>>>
+    {
+        static_assert(!std::is_pointer_v<T>, "codec can not send pointers, they are not valid in another process.");
+
+        static void encode(byte_buffer& out, const T& value)
+        {
+            auto bytes = reinterpret_cast<const unsigned char*>(&value);
+            out.insert(end(out), bytes, bytes + sizeof(T));
+        }
+
+        static T decode(byte_reader& in)
+        {
+            alignas(T) unsigned char buffer[sizeof(T)];
+            std::memcpy(buffer, in.read(sizeof(T)), sizeof(T));
+            return *std::launder(reinterpret_cast<T*>(buffer));
+        }
+    };
+
+    template <>
+    struct codec<std::string>
+    {
+        static void encode(byte_buffer& out, const std::string& value)
+        {
+            encode_varint(out, value.size());
+            out.insert(end(out), begin(value), end(value));
+        }
+
+        static std::string decode(byte_reader& in)
+        {
+            auto size = static_cast<size_t>(decode_varint(in));
+            auto data = reinterpret_cast<const char*>(in.read(size));
+            return std::string(data, size);
+        }
+    };
+
+    template <typename T>
+    struct codec<std::vector<T>>
+    {
+        static void encode(byte_buffer& out, const std::vector<T>& value)
+        {
+            encode_varint(out, value.size());
+            for (const auto& v : value)
+            {
+                codec<T>::encode(out, v);
+            }
+        }
+
+        static std::vector<T> decode(byte_reader& in)
+        {
+            auto size   = static_cast<size_t>(decode_varint(in));
+            auto result = std::vector<T>{};
+            result.reserve(std::min(size, in.remaining()));
+            for (auto i = size_t{0}; i < size; i++)
+            {
+                result.push_back(codec<T>::decode(in));
+            }
+            return result;
+        }
+    };
+
+    //! Append the encoding of the argument pack to out.
+    template <typename... Args>
+    void encode_args(byte_buffer& out, const Args&... args)
+    {
+        (codec<std::decay_t<Args>>::encode(out, args), ...);
+    }
+
+    //! Decode an argument pack written by encode_args.
+    template <typename... Args>
+    std::tuple<std::decay_t<Args>...> decode_args(byte_reader& in)
+    {
+        // braced initialization evaluates the arguments left to right
+        return std::tuple<std::decay_t<Args>...>{codec<std::decay_t<Args>>::decode(in)...};
+    }
+}
+
+#endif
@@ -0,0 +1,291 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef _RSIG_DYNAMIC_SIGNAL_H_
+#define _RSIG_DYNAMIC_SIGNAL_H_
+
+#include <memory>
+#include <string>
+#include <typeindex>
+#include <utility>
+#include <variant>
+
+#include "rsig.h"
+
+namespace rsig
+{
+    //! Type of a dynamic signal argument.
+    enum class value_type
+    {
+        boolean,
+        integer,
+        number,
+        string
+    };
+
+    //! Dynamic signal argument, the alternatives are in value_type order.
+    using value = std::variant<bool, std::int64_t, double, std::string>;
+
+    namespace detail
+    {
+        //! Keeps the pack given to connect from being deduced from a lambda.
+        template <typename T>
+        struct non_deduced
+        {
+            using type = T;
+        };
+    }
+
+    //! The value_type of a C++ argument type.
+    template <typename T>
+    struct value_type_of;
+
+    template <>
+    struct value_type_of<bool> : std::integral_constant<value_type, value_type::boolean> {};
+
+    template <>
+    struct value_type_of<std::int64_t> : std::integral_constant<value_type, value_type::integer> {};
+
+    template <>
+    struct value_type_of<double> : std::integral_constant<value_type, value_type::number> {};
+
+    template <>
+    struct value_type_of<std::string> : std::integral_constant<value_type, value_type::string> {};
+
+    /*!
+     * A signal whose arguments are described at runtime.
+     *
+     * Script bindings connect and emit with vectors of values, that are
+     * checked against the schema. C++ code connects and emits with the
+     * matching compile time signature; these observers sit in a typed
+     * signal and a typed emit calls them without any conversion. Values are
+     * only converted when an emission crosses between the two worlds.
+     */
+    class dynamic_signal
+    {
+    public:
+        /*!
+         * Create a dynamic signal.
+         *
+         * @param schema the types of the arguments
+         */
+        explicit dynamic_signal(std::vector<value_type> schema);
+        ~dynamic_signal() = default;
+
+        //! The types of the arguments.
+        const std::vector<value_type>& get_schema() const noexcept;
+
+        /*!
+         * Connect a typed observer.
+         *
+         * @param fun the function that will be called when emit is called.
+         * @return the connection for this observer
+         *
+         * @throws std::invalid_argument if Args does not match the schema
+         *
+         * @note Args are given explicitly, e.g. connect<std::int64_t>(fun).
+         */
+        template <typename... Args>
+        connection connect(const typename detail::non_deduced<std::function<void(Args...)>>::type& fun);
+
+        /*!
+         * Connect a dynamic observer.
+         *
+         * @param fun the function that will be called when emit is called.
+         * @return the connection for this observer
+         */
+        connection connect_dynamic(const std::function<void(const std::vector<value>&)>& fun);
+
+        /*!
+         * Disconnect an observer.
+         *
+         * @param id the connection returned by connect or connect_dynamic
+         */
+        void disconnect(connection id);
+
+        /*!
+         * Emit with typed arguments.
+         *
+         * @param args the values of this signal event
+         * @return the number of called functions
+         *
+         * @throws std::invalid_argument if Args does not match the schema
+         */
+        template <typename... Args>
+        size_t emit(Args... args);
+
+        /*!
+         * Emit with dynamic arguments.
+         *
+         * @param args the values of this signal event
+         * @return the number of called functions
+         *
+         * @throws std::invalid_argument if args does not match the schema
+         */
+        size_t emit_dynamic(const std::vector<value>& args);
+
+    private:
+        struct typed_signal
+        {
+            std::type_index                                         type;
+            std::shared_ptr<void>                                   sig;
+            std::function<size_t (const std::vector<value>&)>       emit_values;
+            std::function<void (connection)>                        disconnect;
+        };
+
+        std::vector<value_type>                 schema;
+        signal<const std::vector<value>&>       dynamic_observers;
+        std::atomic<size_t>                     dynamic_count = 0;
+
+        std::mutex                              mutex;
+        std::unique_ptr<typed_signal>           typed_owner;
+        std::atomic<typed_signal*>              typed = nullptr;
+
+        template <typename... Args>
+        signal<Args...>& get_typed();
+
+        template <typename... Args, size_t... I>
+        static size_t emit_typed(signal<Args...>& sig, const std::vector<value>& args, std::index_sequence<I...>);
+
+        dynamic_signal(const dynamic_signal&) = delete;
+        dynamic_signal& operator = (const dynamic_signal&) = delete;
+    };
+
+    inline dynamic_signal::dynamic_signal(std::vector<value_type> s)
+    : schema(std::move(s)) {}
+
+    inline const std::vector<value_type>& dynamic_signal::get_schema() const noexcept
+    {
+        return schema;
+    }
+
+    template <typename... Args>
+    connection dynamic_signal::connect(const typename detail::non_deduced<std::function<void(Args...)>>::type& fun)
+    {
+        return get_typed<Args...>().connect(fun);
+    }
+
+    inline connection dynamic_signal::connect_dynamic(const std::function<void(const std::vector<value>&)>& fun)
+    {
+        auto c = dynamic_observers.connect(fun);
+        dynamic_count++;
+        return c;
+    }
+
+    inline void dynamic_signal::disconnect(connection id)
+    {
+        if (id.signal == &dynamic_observers)
+        {
+            dynamic_observers.disconnect(id);
+            dynamic_count--;
+            return;
+        }
+
+        auto t = typed.load(std::memory_order_acquire);
+        if (t == nullptr || id.signal != t->sig.get())
+        {
+            throw std::invalid_argument("dynamic_signal::disconnect: mismatched connection");
+        }
+        t->disconnect(id);
+    }
+
+    template <typename... Args>
+    size_t dynamic_signal::emit(Args... args)
+    {
+        auto count = get_typed<Args...>().emit(args...);
+        if (dynamic_count.load(std::memory_order_relaxed) != 0)
+        {
+            count += dynamic_observers.emit(std::vector<value>{value(args)...});
+        }
+        return count;
+    }
+
+    inline size_t dynamic_signal::emit_dynamic(const std::vector<value>& args)
+    {
+        if (args.size() != schema.size())
+        {
+            throw std::invalid_argument("dynamic_signal::emit_dynamic: wrong number of arguments");
+        }
+        for (auto i = size_t{0}; i < args.size(); i++)
+        {
+            if (args[i].index() != static_cast<size_t>(schema[i]))
+            {
+                throw std::invalid_argument("dynamic_signal::emit_dynamic: wrong argument type");
+            }
+        }
+
+        auto count = dynamic_observers.emit(args);
+        if (auto t = typed.load(std::memory_order_acquire))
+        {
+            count += t->emit_values(args);
+        }
+        return count;
+    }
+
+    template <typename... Args>
+    signal<Args...>& dynamic_signal::get_typed()
+    {
+        auto t = typed.load(std::memory_order_acquire);
+        if (t == nullptr)
+        {
+            std::scoped_lock<std::mutex> sl(mutex);
+            t = typed.load(std::memory_order_relaxed);
+            if (t == nullptr)
+            {
+                auto types = std::vector<value_type>{value_type_of<Args>::value...};
+                if (types != schema)
+                {
+                    throw std::invalid_argument("dynamic_signal: signature does not match the schema");
+                }
+
+                auto sig = std::make_shared<signal<Args...>>();
+                typed_owner.reset(new typed_signal{
+                    typeid(signal<Args...>),
+                    sig,
+                    [s = sig.get()] (const std::vector<value>& args) {
+                        return emit_typed(*s, args, std::index_sequence_for<Args...>{});
+                    },
+                    [s = sig.get()] (connection id) {
+                        s->disconnect(id);
+                    }
+                });
+                t = typed_owner.get();
+                typed.store(t, std::memory_order_release);
+            }
+        }
+
+        if (t->type != typeid(signal<Args...>))
+        {
+            throw std::invalid_argument("dynamic_signal: signature does not match the schema");
+        }
+        return *static_cast<signal<Args...>*>(t->sig.get());
+    }
+
+    template <typename... Args, size_t... I>
+    size_t dynamic_signal::emit_typed(signal<Args...>& sig, const std::vector<value>& args, std::index_sequence<I...>)
+    {
+        return sig.emit(std::get<Args>(args[I])...);
+    }
+}
+
+#endif
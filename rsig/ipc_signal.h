@@ -0,0 +1,511 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef _RSIG_IPC_SIGNAL_H_
+#define _RSIG_IPC_SIGNAL_H_
+
+#ifndef __linux__
+#error "rsig/ipc_signal.h requires Linux."
+#endif
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rsig.h"
+
+namespace rsig
+{
+    namespace detail
+    {
+        //! Byte layout of a pack of trivially copyable values.
+        template <typename... Args>
+        struct packed
+        {
+            static constexpr size_t sizes[] = {sizeof(Args)..., 0};
+            static constexpr size_t size    = (sizeof(Args) + ... + 0);
+
+            static constexpr size_t offset(size_t index)
+            {
+                auto result = size_t{0};
+                for (auto i = size_t{0}; i < index; i++)
+                {
+                    result += sizes[i];
+                }
+                return result;
+            }
+
+            static void store(unsigned char* out, const Args&... args)
+            {
+                auto off = size_t{0};
+                ((std::memcpy(out + off, &args, sizeof(Args)), off += sizeof(Args)), ...);
+            }
+
+            template <typename T>
+            static T load(const unsigned char* in)
+            {
+                alignas(T) unsigned char buffer[sizeof(T)];
+                std::memcpy(buffer, in, sizeof(T));
+                return *std::launder(reinterpret_cast<T*>(buffer));
+            }
+        };
+
+        inline void check_errno(bool ok, const char* what)
+        {
+            if (!ok)
+            {
+                throw std::system_error(errno, std::generic_category(), what);
+            }
+        }
+
+        inline long futex(std::atomic<std::uint32_t>* word, int op, std::uint32_t value, const timespec* timeout = nullptr)
+        {
+            static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t));
+            return syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(word), op, value, timeout, nullptr, 0);
+        }
+    }
+
+    /*!
+     * A signal that is shared between processes on the same host.
+     *
+     * The events are written into a ring buffer in POSIX shared memory. Every
+     * process that opens the same name gets its own read position and
+     * delivers the events to its local observers when dispatch or wait is
+     * called. Emitting and dispatching only use atomics; the futex syscall
+     * is only made when a process is waiting for events.
+     *
+     * @note Only trivially copyable arguments can be sent over shared memory.
+     *
+     * @note The ring buffer overwrites the oldest events, a process that
+     * falls behind by more than the capacity loses events, see lost.
+     *
+     * @note An event that stays unwritten for longer than the stall timeout,
+     * because its producer stopped or died in the middle of emit, is
+     * skipped and counted as lost, so it does not hold up the later events.
+     */
+    template <typename... Args>
+    class ipc_signal
+    {
+        static_assert((std::is_trivially_copyable_v<Args> && ...), "ipc_signal arguments must be trivially copyable.");
+
+    public:
+        /*!
+         * Open or create a shared signal.
+         *
+         * @param name the shared memory object name, for example "/my-events"
+         * @param capacity the number of events the ring buffer can hold
+         * @param stall the time after which an unwritten event is skipped
+         *
+         * @throws std::runtime_error if an existing object is not set up
+         * within the stall timeout, for example because its creator died
+         */
+        explicit ipc_signal(const std::string& name, std::uint32_t capacity = 1024u,
+                            std::chrono::milliseconds stall = std::chrono::milliseconds(100));
+        ~ipc_signal();
+
+        //! Remove the shared memory object, mapped signals stay valid.
+        static void unlink(const std::string& name);
+
+        /*!
+         * Connect an observer in this process.
+         *
+         * @param fun the lambda function that will be called by dispatch.
+         * @return the connection for this observer
+         */
+        connection connect(const std::function<void(Args...)>& fun);
+
+        /*!
+         * Disconnect an observer.
+         *
+         * @param id the connection returned by connect
+         */
+        void disconnect(connection id);
+
+        /*!
+         * Emit a signal to all processes.
+         *
+         * Any number of threads and processes may emit concurrently. A
+         * producer that finds its slot still being written by a producer of
+         * the previous lap waits for it, at most for the stall timeout.
+         *
+         * @param args the values of this signal event
+         */
+        void emit(Args... args);
+
+        /*!
+         * Deliver the pending events to the observers in this process.
+         *
+         * @return the number of delivered events
+         */
+        size_t dispatch();
+
+        /*!
+         * Wait for events and deliver them.
+         *
+         * @param timeout the maximum time to wait
+         * @return the number of delivered events
+         */
+        size_t wait(std::chrono::milliseconds timeout);
+
+        //! The number of events this process missed, because it fell behind or they were never written.
+        std::uint64_t lost() const;
+
+    private:
+        using layout = detail::packed<Args...>;
+
+        static constexpr std::uint32_t magic = 0x72736967u;
+
+        struct header
+        {
+            std::atomic<std::uint32_t> ready;
+            std::uint32_t              capacity;
+            std::uint32_t              payload_size;
+            std::atomic<std::uint64_t> head;
+            // incremented on every emit, used as futex word
+            std::atomic<std::uint32_t> events;
+            std::atomic<std::uint32_t> waiters;
+        };
+
+        struct slot
+        {
+            // 2 * ticket + 1 while writing, 2 * ticket + 2 when written
+            std::atomic<std::uint64_t> seq;
+            unsigned char              data[layout::size == 0 ? 1 : layout::size];
+        };
+
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "ipc_signal requires lock free 64 bit atomics.");
+
+        using clock = std::chrono::steady_clock;
+
+        int                 fd     = -1;
+        size_t              length = 0;
+        void*               memory = nullptr;
+        header*             head   = nullptr;
+        slot*               slots  = nullptr;
+        std::uint64_t       cursor = 0;
+        std::uint64_t       missed = 0;
+        clock::duration     stall_timeout;
+        // the ticket the reader is stuck on and since when
+        std::uint64_t       stalled = ~std::uint64_t{0};
+        clock::time_point   stalled_since;
+        signal<Args...>     local;
+
+        bool published(std::uint64_t ticket) const;
+        clock::duration stall_left(clock::time_point now);
+
+        template <size_t... I>
+        void deliver(const unsigned char* data, std::index_sequence<I...>);
+
+        ipc_signal(const ipc_signal<Args...>&) = delete;
+        ipc_signal<Args...>& operator = (const ipc_signal<Args...>&) = delete;
+    };
+
+    template <typename... Args>
+    ipc_signal<Args...>::ipc_signal(const std::string& name, std::uint32_t capacity, std::chrono::milliseconds stall)
+    : stall_timeout(stall)
+    {
+        if (capacity == 0)
+        {
+            throw std::invalid_argument("ipc_signal: capacity must not be zero");
+        }
+
+        length = sizeof(header) + sizeof(slot) * capacity;
+
+        auto created = true;
+        fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd == -1 && errno == EEXIST)
+        {
+            created = false;
+            fd = shm_open(name.c_str(), O_RDWR, 0600);
+        }
+        detail::check_errno(fd != -1, "ipc_signal: shm_open failed");
+
+        try
+        {
+            if (created)
+            {
+                detail::check_errno(ftruncate(fd, static_cast<off_t>(length)) == 0, "ipc_signal: ftruncate failed");
+            }
+            else
+            {
+                // the creator may not have sized the object yet
+                auto deadline = clock::now() + stall_timeout;
+                struct stat st = {};
+                detail::check_errno(fstat(fd, &st) == 0, "ipc_signal: fstat failed");
+                while (st.st_size == 0)
+                {
+                    if (clock::now() > deadline)
+                    {
+                        throw std::runtime_error("ipc_signal: shared memory was not set up");
+                    }
+                    std::this_thread::yield();
+                    detail::check_errno(fstat(fd, &st) == 0, "ipc_signal: fstat failed");
+                }
+
+                if (static_cast<size_t>(st.st_size) != length)
+                {
+                    throw std::runtime_error("ipc_signal: shared memory has a different layout");
+                }
+            }
+
+            memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            detail::check_errno(memory != MAP_FAILED, "ipc_signal: mmap failed");
+        }
+        catch (...)
+        {
+            close(fd);
+            throw;
+        }
+
+        head  = static_cast<header*>(memory);
+        slots = reinterpret_cast<slot*>(static_cast<unsigned char*>(memory) + sizeof(header));
+
+        if (created)
+        {
+            // ftruncate zero fills, so the atomics are already zero
+            head->capacity     = capacity;
+            head->payload_size = static_cast<std::uint32_t>(layout::size);
+            head->ready.store(magic, std::memory_order_release);
+        }
+        else
+        {
+            auto deadline = clock::now() + stall_timeout;
+            while (head->ready.load(std::memory_order_acquire) != magic)
+            {
+                if (clock::now() > deadline)
+                {
+                    munmap(memory, length);
+                    close(fd);
+                    throw std::runtime_error("ipc_signal: shared memory was not set up");
+                }
+                std::this_thread::yield();
+            }
+            if (head->capacity != capacity || head->payload_size != layout::size)
+            {
+                munmap(memory, length);
+                close(fd);
+                throw std::runtime_error("ipc_signal: shared memory has a different layout");
+            }
+        }
+
+        cursor = head->head.load(std::memory_order_acquire);
+    }
+
+    template <typename... Args>
+    ipc_signal<Args...>::~ipc_signal()
+    {
+        munmap(memory, length);
+        close(fd);
+    }
+
+    template <typename... Args>
+    void ipc_signal<Args...>::unlink(const std::string& name)
+    {
+        shm_unlink(name.c_str());
+    }
+
+    template <typename... Args>
+    connection ipc_signal<Args...>::connect(const std::function<void(Args...)>& fun)
+    {
+        return local.connect(fun);
+    }
+
+    template <typename... Args>
+    void ipc_signal<Args...>::disconnect(connection id)
+    {
+        local.disconnect(id);
+    }
+
+    template <typename... Args>
+    void ipc_signal<Args...>::emit(Args... args)
+    {
+        auto ticket = head->head.fetch_add(1, std::memory_order_acq_rel);
+        auto& s = slots[ticket % head->capacity];
+
+        // claim the slot from an earlier lap, tickets that are a capacity
+        // apart must not write the same slot at the same time
+        auto claim = 2 * ticket + 1;
+        auto seq   = s.seq.load(std::memory_order_relaxed);
+        auto since = clock::time_point{};
+        while (true)
+        {
+            if (seq >= claim)
+            {
+                // a later lap took the slot, this event is lost
+                return;
+            }
+            if (seq % 2 == 1)
+            {
+                // the producer of an earlier lap is still writing, take
+                // the slot over once it stalled
+                auto now = clock::now();
+                if (since == clock::time_point{})
+                {
+                    since = now;
+                }
+                if (now - since < stall_timeout)
+                {
+                    std::this_thread::yield();
+                    seq = s.seq.load(std::memory_order_relaxed);
+                    continue;
+                }
+            }
+            if (s.seq.compare_exchange_weak(seq, claim, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        layout::store(s.data, args...);
+        // a stalled producer must not publish over the slot it lost
+        s.seq.compare_exchange_strong(claim, claim + 1, std::memory_order_release, std::memory_order_relaxed);
+
+        head->events.fetch_add(1, std::memory_order_seq_cst);
+        if (head->waiters.load(std::memory_order_seq_cst) != 0)
+        {
+            detail::futex(&head->events, FUTEX_WAKE, INT_MAX);
+        }
+    }
+
+    template <typename... Args>
+    size_t ipc_signal<Args...>::dispatch()
+    {
+        auto count = size_t{0};
+        auto data  = std::array<unsigned char, sizeof(slot::data)>{};
+        while (true)
+        {
+            auto end = head->head.load(std::memory_order_acquire);
+            if (end - cursor > head->capacity)
+            {
+                missed += end - cursor - head->capacity;
+                cursor  = end - head->capacity;
+            }
+            if (cursor == end)
+            {
+                return count;
+            }
+
+            auto& s   = slots[cursor % head->capacity];
+            auto seq1 = s.seq.load(std::memory_order_acquire);
+            if (seq1 < 2 * cursor + 2)
+            {
+                // the producer is still writing this event, or it died
+                // after taking the ticket; give up on it after a while
+                if (stall_left(clock::now()) != clock::duration::zero())
+                {
+                    return count;
+                }
+                missed++;
+                cursor++;
+                continue;
+            }
+
+            std::memcpy(data.data(), s.data, data.size());
+            std::atomic_thread_fence(std::memory_order_acquire);
+            auto seq2 = s.seq.load(std::memory_order_relaxed);
+            if (seq1 != 2 * cursor + 2 || seq2 != seq1)
+            {
+                // overwritten while reading, resynchronize on the next pass
+                missed++;
+                cursor++;
+                continue;
+            }
+
+            cursor++;
+            deliver(data.data(), std::index_sequence_for<Args...>{});
+            count++;
+        }
+    }
+
+    template <typename... Args>
+    size_t ipc_signal<Args...>::wait(std::chrono::milliseconds timeout)
+    {
+        head->waiters.fetch_add(1, std::memory_order_seq_cst);
+        auto events = head->events.load(std::memory_order_seq_cst);
+        auto end    = head->head.load(std::memory_order_acquire);
+        if (end == cursor || (end - cursor <= head->capacity && !published(cursor)))
+        {
+            // sleep until the event is written or the stall timeout passes
+            auto ns = std::chrono::nanoseconds(timeout);
+            if (end != cursor)
+            {
+                ns = std::min(ns, std::chrono::duration_cast<std::chrono::nanoseconds>(stall_left(clock::now())));
+            }
+            auto ts = timespec{};
+            ts.tv_sec  = static_cast<time_t>(ns.count() / 1000000000);
+            ts.tv_nsec = static_cast<long>(ns.count() % 1000000000);
+            detail::futex(&head->events, FUTEX_WAIT, events, &ts);
+        }
+        head->waiters.fetch_sub(1, std::memory_order_seq_cst);
+        return dispatch();
+    }
+
+    template <typename... Args>
+    std::uint64_t ipc_signal<Args...>::lost() const
+    {
+        return missed;
+    }
+
+    template <typename... Args>
+    bool ipc_signal<Args...>::published(std::uint64_t ticket) const
+    {
+        return slots[ticket % head->capacity].seq.load(std::memory_order_acquire) >= 2 * ticket + 2;
+    }
+
+    template <typename... Args>
+    typename ipc_signal<Args...>::clock::duration ipc_signal<Args...>::stall_left(clock::time_point now)
+    {
+        if (stalled != cursor)
+        {
+            stalled       = cursor;
+            stalled_since = now;
+        }
+        auto elapsed = now - stalled_since;
+        return elapsed < stall_timeout ? stall_timeout - elapsed : clock::duration::zero();
+    }
+
+    template <typename... Args>
+    template <size_t... I>
+    void ipc_signal<Args...>::deliver(const unsigned char* data, std::index_sequence<I...>)
+    {
+        local.emit(layout::template load<Args>(data + layout::offset(I))...);
+    }
+}
+
+#endif
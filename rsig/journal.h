@@ -0,0 +1,386 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef _RSIG_JOURNAL_H_
+#define _RSIG_JOURNAL_H_
+
+#ifndef __linux__
+#error "rsig/journal.h requires Linux."
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "rsig.h"
+#include "codec.h"
+
+namespace rsig
+{
+    namespace detail
+    {
+        struct journal_header
+        {
+            std::uint64_t              magic;
+            std::atomic<std::uint64_t> tail;
+        };
+
+        struct journal_record
+        {
+            std::uint64_t              time;
+            std::uint32_t              label;
+            std::uint32_t              kind;
+            std::uint32_t              size;
+            // written last, a record with zero commit is incomplete
+            std::atomic<std::uint32_t> commit;
+        };
+
+        constexpr std::uint64_t journal_magic = 0x6c6e726a67697372ull;
+
+        enum journal_kind : std::uint32_t
+        {
+            journal_label = 1,
+            journal_event = 2
+        };
+
+        inline size_t journal_align(size_t size)
+        {
+            return (size + 7u) & ~size_t{7u};
+        }
+
+        inline void journal_check(bool ok, const char* what)
+        {
+            if (!ok)
+            {
+                throw std::system_error(errno, std::generic_category(), what);
+            }
+        }
+    }
+
+    /*!
+     * Append only, memory mapped journal of signal emissions.
+     *
+     * Each recorded emission is stored with a timestamp, the label of the
+     * signal and the arguments encoded with codec. Appending reserves space
+     * with one atomic add and copies the record into the mapped file, the
+     * emitting thread never makes a syscall.
+     *
+     * @note The journal has a fixed capacity, records that do not fit are
+     * dropped and counted.
+     */
+    class journal
+    {
+    public:
+        /*!
+         * Create a journal file.
+         *
+         * @param path the file to write, an existing file is replaced
+         * @param capacity the maximum size of the file in bytes
+         */
+        journal(const std::string& path, size_t capacity);
+        ~journal();
+
+        /*!
+         * Record all emissions of a signal.
+         *
+         * @param sig the signal to record
+         * @param label the name of the signal in the journal
+         * @return the connection of the recording observer
+         *
+         * @note Disconnect the returned connection to stop recording; the
+         * journal must outlive the connection.
+         */
+        template <typename... Args>
+        connection record(signal<Args...>& sig, const std::string& label);
+
+        //! The number of bytes used.
+        size_t size() const noexcept;
+
+        //! The number of records that were dropped, because the journal was full.
+        size_t dropped() const noexcept;
+
+        //! Write the mapped pages to disk.
+        void sync();
+
+    private:
+        int                          fd       = -1;
+        size_t                       capacity = 0;
+        unsigned char*               memory   = nullptr;
+        detail::journal_header*      header   = nullptr;
+        std::atomic<std::uint32_t>   last_label = 0;
+        std::atomic<size_t>          lost       = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        void append(std::uint32_t label, std::uint32_t kind, const byte_buffer& payload);
+
+        journal(const journal&) = delete;
+        journal& operator = (const journal&) = delete;
+    };
+
+    //! How fast a journal is replayed.
+    enum class replay_speed
+    {
+        original,   //!< keep the recorded time between emissions
+        fast        //!< emit as fast as possible
+    };
+
+    /*!
+     * Replay a journal into live signals.
+     */
+    class journal_reader
+    {
+    public:
+        /*!
+         * Open a journal file.
+         *
+         * @param path the journal file
+         */
+        explicit journal_reader(const std::string& path);
+        ~journal_reader();
+
+        /*!
+         * Emit the records of a label on a signal during replay.
+         *
+         * @param label the name of the signal in the journal
+         * @param sig the signal to emit on
+         *
+         * @note The signal must have the same arguments as the recorded one.
+         */
+        template <typename... Args>
+        void bind(const std::string& label, signal<Args...>& sig);
+
+        /*!
+         * Replay all records.
+         *
+         * Records of labels that are not bound are skipped.
+         *
+         * @param speed the replay speed
+         * @return the number of replayed emissions
+         */
+        size_t replay(replay_speed speed = replay_speed::fast);
+
+    private:
+        int                  fd     = -1;
+        size_t               length = 0;
+        const unsigned char* memory = nullptr;
+        std::unordered_map<std::string, std::function<void (byte_reader&)>> sinks;
+
+        journal_reader(const journal_reader&) = delete;
+        journal_reader& operator = (const journal_reader&) = delete;
+    };
+
+    inline journal::journal(const std::string& path, size_t c)
+    : capacity(detail::journal_align(c))
+    {
+        if (capacity <= sizeof(detail::journal_header))
+        {
+            throw std::invalid_argument("journal: capacity is too small");
+        }
+
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        detail::journal_check(fd != -1, "journal: open failed");
+        if (ftruncate(fd, static_cast<off_t>(capacity)) != 0)
+        {
+            auto error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "journal: ftruncate failed");
+        }
+        auto m = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (m == MAP_FAILED)
+        {
+            auto error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "journal: mmap failed");
+        }
+
+        memory = static_cast<unsigned char*>(m);
+        header = reinterpret_cast<detail::journal_header*>(memory);
+        header->magic = detail::journal_magic;
+        header->tail.store(sizeof(detail::journal_header), std::memory_order_release);
+    }
+
+    inline journal::~journal()
+    {
+        munmap(memory, capacity);
+        ::close(fd);
+    }
+
+    template <typename... Args>
+    connection journal::record(signal<Args...>& sig, const std::string& label)
+    {
+        auto id = ++last_label;
+        auto name = byte_buffer(begin(label), end(label));
+        append(id, detail::journal_label, name);
+
+        return sig.connect([this, id] (Args... args) {
+            thread_local byte_buffer payload;
+            payload.clear();
+            encode_args(payload, args...);
+            append(id, detail::journal_event, payload);
+        });
+    }
+
+    inline size_t journal::size() const noexcept
+    {
+        return std::min(static_cast<size_t>(header->tail.load(std::memory_order_acquire)), capacity);
+    }
+
+    inline size_t journal::dropped() const noexcept
+    {
+        return lost.load(std::memory_order_relaxed);
+    }
+
+    inline void journal::sync()
+    {
+        detail::journal_check(msync(memory, capacity, MS_SYNC) == 0, "journal: msync failed");
+    }
+
+    inline void journal::append(std::uint32_t label, std::uint32_t kind, const byte_buffer& payload)
+    {
+        auto time   = std::chrono::steady_clock::now() - start;
+        auto length = detail::journal_align(sizeof(detail::journal_record) + payload.size());
+        auto offset = static_cast<size_t>(header->tail.fetch_add(length, std::memory_order_relaxed));
+        if (offset + length > capacity)
+        {
+            lost.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        auto record = reinterpret_cast<detail::journal_record*>(memory + offset);
+        record->time  = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count());
+        record->label = label;
+        record->kind  = kind;
+        record->size  = static_cast<std::uint32_t>(payload.size());
+        std::memcpy(memory + offset + sizeof(detail::journal_record), payload.data(), payload.size());
+        record->commit.store(1, std::memory_order_release);
+    }
+
+    inline journal_reader::journal_reader(const std::string& path)
+    {
+        fd = ::open(path.c_str(), O_RDONLY);
+        detail::journal_check(fd != -1, "journal_reader: open failed");
+
+        struct stat st = {};
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(detail::journal_header))
+        {
+            ::close(fd);
+            throw std::runtime_error("journal_reader: not a journal");
+        }
+        length = static_cast<size_t>(st.st_size);
+
+        auto m = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (m == MAP_FAILED)
+        {
+            auto error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "journal_reader: mmap failed");
+        }
+        memory = static_cast<const unsigned char*>(m);
+
+        if (reinterpret_cast<const detail::journal_header*>(memory)->magic != detail::journal_magic)
+        {
+            munmap(m, length);
+            ::close(fd);
+            throw std::runtime_error("journal_reader: not a journal");
+        }
+    }
+
+    inline journal_reader::~journal_reader()
+    {
+        munmap(const_cast<unsigned char*>(memory), length);
+        ::close(fd);
+    }
+
+    template <typename... Args>
+    void journal_reader::bind(const std::string& label, signal<Args...>& sig)
+    {
+        sinks[label] = [&sig] (byte_reader& in) {
+            std::apply([&sig] (auto&&... args) {
+                sig.emit(args...);
+            }, decode_args<Args...>(in));
+        };
+    }
+
+    inline size_t journal_reader::replay(replay_speed speed)
+    {
+        auto header = reinterpret_cast<const detail::journal_header*>(memory);
+        auto tail   = std::min(static_cast<size_t>(header->tail.load(std::memory_order_acquire)), length);
+        auto start  = std::chrono::steady_clock::now();
+        auto first  = std::optional<std::uint64_t>{};
+
+        // labels are numbered per journal, map them to the bound sinks
+        std::unordered_map<std::uint32_t, const std::function<void (byte_reader&)>*> labels;
+
+        auto count  = size_t{0};
+        auto offset = sizeof(detail::journal_header);
+        while (offset + sizeof(detail::journal_record) <= tail)
+        {
+            auto record = reinterpret_cast<const detail::journal_record*>(memory + offset);
+            if (record->commit.load(std::memory_order_acquire) == 0 || offset + sizeof(detail::journal_record) + record->size > tail)
+            {
+                // a record that was not completed, the recording was cut short
+                break;
+            }
+            auto payload = memory + offset + sizeof(detail::journal_record);
+            offset += detail::journal_align(sizeof(detail::journal_record) + record->size);
+
+            if (record->kind == detail::journal_label)
+            {
+                auto i = sinks.find(std::string(reinterpret_cast<const char*>(payload), record->size));
+                labels[record->label] = i != end(sinks) ? &i->second : nullptr;
+                continue;
+            }
+
+            auto i = labels.find(record->label);
+            if (i == end(labels) || i->second == nullptr)
+            {
+                continue;
+            }
+
+            if (speed == replay_speed::original)
+            {
+                if (!first)
+                {
+                    first = record->time;
+                }
+                std::this_thread::sleep_until(start + std::chrono::nanoseconds(record->time - *first));
+            }
+
+            auto in = byte_reader(payload, record->size);
+            (*i->second)(in);
+            count++;
+        }
+        return count;
+    }
+}
+
+#endif
@@ -0,0 +1,448 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef _RSIG_PIPELINE_H_
+#define _RSIG_PIPELINE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+#include "rsig.h"
+
+namespace rsig
+{
+    //! Counters of a pipeline stage.
+    struct stage_stats
+    {
+        size_t                   depth     = 0; //!< queued events
+        size_t                   workers   = 0; //!< running workers
+        size_t                   processed = 0; //!< events handled so far
+        std::chrono::nanoseconds service_time;  //!< mean time to handle an event
+    };
+
+    namespace detail
+    {
+        //! The part of a stage the pipeline controller works with.
+        class stage_control
+        {
+        public:
+            virtual ~stage_control() = default;
+
+            virtual stage_stats get_stats() const = 0;
+            virtual void resize(size_t workers) = 0;
+
+            size_t min_workers = 1;
+            size_t max_workers = 1;
+        };
+    }
+
+    /*!
+     * A stage of a pipeline.
+     *
+     * Emitting queues the event in a bounded queue and the workers of the
+     * stage call the observers. An observer hands its result on by
+     * emitting the next stage. When the queue is full, emit blocks until a
+     * worker takes an event, so a slow stage holds back the stages before.
+     *
+     * @note The observers are called concurrently by all workers.
+     */
+    template <typename... Args>
+    class stage : public detail::stage_control
+    {
+    public:
+        /*!
+         * Create a stage.
+         *
+         * @param capacity the maximum number of queued events
+         * @param workers the number of workers to start with
+         */
+        explicit stage(size_t capacity = 1024, size_t workers = 1);
+        ~stage();
+
+        /*!
+         * Connect an observer to the stage.
+         *
+         * @param fun the lambda function that will be called by the workers.
+         * @return the connection for this observer
+         */
+        connection connect(const std::function<void(Args...)>& fun);
+
+        /*!
+         * Disconnect an observer.
+         *
+         * @param id the connection returned by connect
+         */
+        void disconnect(connection id);
+
+        /*!
+         * Queue an event, waiting while the queue is full.
+         *
+         * @param args the values of this signal event
+         */
+        void emit(Args... args);
+
+        /*!
+         * Queue an event, if the queue is not full.
+         *
+         * @param args the values of this signal event
+         * @return true if the event was queued
+         */
+        bool try_emit(Args... args);
+
+        //! Get the counters of this stage.
+        stage_stats get_stats() const override;
+
+        /*!
+         * Change the number of workers.
+         *
+         * Workers that are removed finish their current event first.
+         *
+         * @param workers the new number of workers, at least one
+         */
+        void resize(size_t workers) override;
+
+    private:
+        struct event
+        {
+            trace_context                       trace;
+            std::tuple<std::decay_t<Args>...>   args;
+        };
+
+        size_t                    capacity;
+        signal<Args...>           observers;
+
+        mutable std::mutex        mutex;
+        std::condition_variable   not_empty;
+        std::condition_variable   not_full;
+        std::deque<event>         queue;
+        size_t                    target  = 0;
+        bool                      stopped = false;
+        size_t                    processed = 0;
+        std::chrono::nanoseconds  busy = std::chrono::nanoseconds(0);
+
+        // serializes resize, workers is only changed under it
+        std::mutex                resize_mutex;
+        std::vector<std::thread>  workers;
+
+        void work(size_t index);
+
+        stage(const stage<Args...>&) = delete;
+        stage<Args...>& operator = (const stage<Args...>&) = delete;
+    };
+
+    /*!
+     * A staged event driven pipeline.
+     *
+     * The pipeline owns its stages and a controller thread that adjusts
+     * the number of workers of each stage. A stage gets another worker
+     * when its queue would take longer than the control interval to drain
+     * and gives one up when its queue is empty.
+     *
+     * Example:
+     * @code
+     * rsig::pipeline p;
+     * auto& parse = p.add_stage<std::string>();
+     * auto& store = p.add_stage<record>();
+     * parse.connect([&] (std::string line) { store.emit(parse_record(line)); });
+     * store.connect([&] (record r) { db.insert(r); });
+     * @endcode
+     */
+    class pipeline
+    {
+    public:
+        /*!
+         * Create a pipeline.
+         *
+         * @param interval the time between adjustments of the worker counts
+         */
+        explicit pipeline(std::chrono::milliseconds interval = std::chrono::milliseconds(100));
+        ~pipeline();
+
+        /*!
+         * Add a stage.
+         *
+         * @param capacity the maximum number of queued events
+         * @param min_workers the least number of workers
+         * @param max_workers the most number of workers, 0 for one per hardware thread
+         * @return the new stage, owned by the pipeline
+         *
+         * @note Events still queued when the pipeline is destroyed are dropped.
+         */
+        template <typename... Args>
+        stage<Args...>& add_stage(size_t capacity = 1024, size_t min_workers = 1, size_t max_workers = 0);
+
+        //! Adjust the number of workers of each stage once.
+        void adjust();
+
+    private:
+        std::chrono::milliseconds   interval;
+        std::mutex                  mutex;
+        std::condition_variable     wake;
+        bool                        stopped = false;
+        std::vector<std::unique_ptr<detail::stage_control>> stages;
+        std::thread                 controller;
+
+        pipeline(const pipeline&) = delete;
+        pipeline& operator = (const pipeline&) = delete;
+    };
+
+    template <typename... Args>
+    stage<Args...>::stage(size_t c, size_t w)
+    : capacity(c)
+    {
+        if (capacity == 0)
+        {
+            throw std::invalid_argument("stage: capacity must not be zero");
+        }
+        min_workers = 1;
+        max_workers = std::max<size_t>(w, 1);
+        resize(w);
+    }
+
+    template <typename... Args>
+    stage<Args...>::~stage()
+    {
+        {
+            std::scoped_lock<std::mutex> sl(mutex);
+            stopped = true;
+        }
+        not_empty.notify_all();
+        not_full.notify_all();
+
+        std::scoped_lock<std::mutex> sl(resize_mutex);
+        for (auto& w : workers)
+        {
+            w.join();
+        }
+    }
+
+    template <typename... Args>
+    connection stage<Args...>::connect(const std::function<void(Args...)>& fun)
+    {
+        return observers.connect(fun);
+    }
+
+    template <typename... Args>
+    void stage<Args...>::disconnect(connection id)
+    {
+        observers.disconnect(id);
+    }
+
+    template <typename... Args>
+    void stage<Args...>::emit(Args... args)
+    {
+        {
+            std::unique_lock<std::mutex> ul(mutex);
+            not_full.wait(ul, [this] { return queue.size() < capacity || stopped; });
+            if (stopped)
+            {
+                return;
+            }
+            queue.push_back({current_trace(), {args...}});
+        }
+        not_empty.notify_one();
+    }
+
+    template <typename... Args>
+    bool stage<Args...>::try_emit(Args... args)
+    {
+        {
+            std::scoped_lock<std::mutex> sl(mutex);
+            if (queue.size() >= capacity || stopped)
+            {
+                return false;
+            }
+            queue.push_back({current_trace(), {args...}});
+        }
+        not_empty.notify_one();
+        return true;
+    }
+
+    template <typename... Args>
+    stage_stats stage<Args...>::get_stats() const
+    {
+        std::scoped_lock<std::mutex> sl(mutex);
+        auto stats = stage_stats{};
+        stats.depth        = queue.size();
+        stats.workers      = target;
+        stats.processed    = processed;
+        stats.service_time = processed != 0 ? busy / static_cast<std::chrono::nanoseconds::rep>(processed) : std::chrono::nanoseconds(0);
+        return stats;
+    }
+
+    template <typename... Args>
+    void stage<Args...>::resize(size_t count)
+    {
+        if (count == 0)
+        {
+            throw std::invalid_argument("stage::resize: a stage needs a worker");
+        }
+
+        std::scoped_lock<std::mutex> rl(resize_mutex);
+        {
+            std::scoped_lock<std::mutex> sl(mutex);
+            if (stopped)
+            {
+                return;
+            }
+            target = count;
+        }
+
+        if (count < workers.size())
+        {
+            not_empty.notify_all();
+            for (auto i = count; i < workers.size(); i++)
+            {
+                workers[i].join();
+            }
+            workers.erase(begin(workers) + static_cast<std::ptrdiff_t>(count), end(workers));
+        }
+        while (workers.size() < count)
+        {
+            workers.emplace_back([this, index = workers.size()] {
+                work(index);
+            });
+        }
+    }
+
+    template <typename... Args>
+    void stage<Args...>::work(size_t index)
+    {
+        std::unique_lock<std::mutex> ul(mutex);
+        while (true)
+        {
+            not_empty.wait(ul, [&] { return !queue.empty() || stopped || index >= target; });
+            if (stopped || index >= target)
+            {
+                return;
+            }
+
+            auto e = std::move(queue.front());
+            queue.pop_front();
+            ul.unlock();
+            not_full.notify_one();
+
+            auto start = std::chrono::steady_clock::now();
+            {
+                trace_scope scope(e.trace);
+                std::apply([this] (auto&... args) {
+                    observers.emit(args...);
+                }, e.args);
+            }
+            auto time = std::chrono::steady_clock::now() - start;
+
+            ul.lock();
+            processed++;
+            busy += std::chrono::duration_cast<std::chrono::nanoseconds>(time);
+        }
+    }
+
+    inline pipeline::pipeline(std::chrono::milliseconds i)
+    : interval(i)
+    {
+        controller = std::thread([this] {
+            std::unique_lock<std::mutex> ul(mutex);
+            while (!stopped)
+            {
+                if (!wake.wait_for(ul, interval, [this] { return stopped; }))
+                {
+                    ul.unlock();
+                    adjust();
+                    ul.lock();
+                }
+            }
+        });
+    }
+
+    inline pipeline::~pipeline()
+    {
+        {
+            std::scoped_lock<std::mutex> sl(mutex);
+            stopped = true;
+        }
+        wake.notify_all();
+        controller.join();
+
+        // earlier stages first, their workers may still emit into later ones
+        for (auto& s : stages)
+        {
+            s.reset();
+        }
+    }
+
+    template <typename... Args>
+    stage<Args...>& pipeline::add_stage(size_t capacity, size_t min_workers, size_t max_workers)
+    {
+        if (max_workers == 0)
+        {
+            max_workers = std::max<size_t>(std::thread::hardware_concurrency(), min_workers);
+        }
+        if (min_workers == 0 || max_workers < min_workers)
+        {
+            throw std::invalid_argument("pipeline::add_stage: invalid worker range");
+        }
+
+        auto s = std::make_unique<stage<Args...>>(capacity, min_workers);
+        s->min_workers = min_workers;
+        s->max_workers = max_workers;
+
+        auto& result = *s;
+        std::scoped_lock<std::mutex> sl(mutex);
+        stages.push_back(std::move(s));
+        return result;
+    }
+
+    inline void pipeline::adjust()
+    {
+        std::vector<detail::stage_control*> current;
+        {
+            std::scoped_lock<std::mutex> sl(mutex);
+            for (auto& s : stages)
+            {
+                current.push_back(s.get());
+            }
+        }
+
+        for (auto s : current)
+        {
+            auto stats = s->get_stats();
+            // the time the current workers need to empty the queue
+            auto drain = stats.service_time * static_cast<std::chrono::nanoseconds::rep>(stats.depth) / static_cast<std::chrono::nanoseconds::rep>(std::max<size_t>(stats.workers, 1));
+            if (stats.depth != 0 && drain > interval && stats.workers < s->max_workers)
+            {
+                s->resize(stats.workers + 1);
+            }
+            else if (stats.depth == 0 && stats.workers > s->min_workers)
+            {
+                s->resize(stats.workers - 1);
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,181 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef _RSIG_POSIX_SIGNAL_H_
+#define _RSIG_POSIX_SIGNAL_H_
+
+#ifndef __linux__
+#error "rsig/posix_signal.h requires Linux."
+#endif
+
+#include <cerrno>
+#include <csignal>
+#include <initializer_list>
+#include <system_error>
+
+#include <pthread.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+
+#include "rsig.h"
+
+namespace rsig
+{
+    /*!
+     * Turn POSIX signals into rsig signal emissions.
+     *
+     * The given POSIX signals are blocked and read from a signalfd, so no
+     * code runs in signal handler context. The thread that calls dispatch
+     * emits the signal with the signal number; a burst of the same POSIX
+     * signal is coalesced into one emission per dispatch.
+     *
+     * The fd can be watched by an event loop, for example:
+     *
+     * @code
+     * rsig::posix_signal signals = {SIGTERM, SIGHUP};
+     * reactor.watch(signals.fd()).connect([&] (auto) { signals.dispatch(); });
+     * @endcode
+     *
+     * @note The POSIX signals are only blocked in the constructing thread
+     * and threads created by it later. Create the adaptor before starting
+     * other threads. The signals stay blocked after destruction.
+     */
+    class posix_signal
+    {
+    public:
+        /*!
+         * Start handling POSIX signals.
+         *
+         * @param signums the POSIX signals to handle
+         */
+        posix_signal(std::initializer_list<int> signums);
+        ~posix_signal();
+
+        //! The signal emitted with the POSIX signal number.
+        signal<int>& get_signal() noexcept;
+
+        //! The signalfd that is readable while POSIX signals are pending.
+        int fd() const noexcept;
+
+        /*!
+         * Emit the pending POSIX signals.
+         *
+         * @return the number of emissions
+         */
+        size_t dispatch();
+
+    private:
+        int         sfd = -1;
+        signal<int> sig;
+
+        posix_signal(const posix_signal&) = delete;
+        posix_signal& operator = (const posix_signal&) = delete;
+    };
+
+    inline posix_signal::posix_signal(std::initializer_list<int> signums)
+    {
+        sigset_t mask;
+        sigemptyset(&mask);
+        for (auto signum : signums)
+        {
+            if (sigaddset(&mask, signum) != 0)
+            {
+                throw std::invalid_argument("posix_signal: invalid signal number");
+            }
+        }
+
+        auto r = pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+        if (r != 0)
+        {
+            throw std::system_error(r, std::generic_category(), "posix_signal: pthread_sigmask failed");
+        }
+
+        sfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+        if (sfd == -1)
+        {
+            throw std::system_error(errno, std::generic_category(), "posix_signal: signalfd failed");
+        }
+    }
+
+    inline posix_signal::~posix_signal()
+    {
+        close(sfd);
+    }
+
+    inline signal<int>& posix_signal::get_signal() noexcept
+    {
+        return sig;
+    }
+
+    inline int posix_signal::fd() const noexcept
+    {
+        return sfd;
+    }
+
+    inline size_t posix_signal::dispatch()
+    {
+        constexpr auto batch_size = 16;
+        signalfd_siginfo infos[batch_size];
+
+        // collect the whole burst first, then emit each signal once
+        sigset_t seen;
+        sigemptyset(&seen);
+        int order[NSIG];
+        auto count = size_t{0};
+
+        while (true)
+        {
+            auto n = read(sfd, infos, sizeof(infos));
+            if (n == -1)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                if (errno == EAGAIN)
+                {
+                    break;
+                }
+                throw std::system_error(errno, std::generic_category(), "posix_signal: read failed");
+            }
+
+            for (auto i = 0u; i < static_cast<size_t>(n) / sizeof(signalfd_siginfo); i++)
+            {
+                auto signum = static_cast<int>(infos[i].ssi_signo);
+                if (sigismember(&seen, signum) == 0)
+                {
+                    sigaddset(&seen, signum);
+                    order[count++] = signum;
+                }
+            }
+        }
+
+        for (auto i = size_t{0}; i < count; i++)
+        {
+            sig.emit(order[i]);
+        }
+        return count;
+    }
+}
+
+#endif
@@ -0,0 +1,218 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef _RSIG_QUEUED_SIGNAL_H_
+#define _RSIG_QUEUED_SIGNAL_H_
+
+#ifndef __linux__
+#error "rsig/queued_signal.h requires Linux."
+#endif
+
+#include <cerrno>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "rsig.h"
+
+namespace rsig
+{
+    /*!
+     * A signal that is dispatched from an event loop.
+     *
+     * Emitting only queues the event. The first event queued after a drain
+     * makes the eventfd readable, so an epoll or io_uring based loop can
+     * wait on the signal next to its sockets and then call drain to call
+     * the observers for all queued events in one batch.
+     *
+     * To queue the events of an existing signal in addition to its direct
+     * observers, connect the queued signal to it:
+     *
+     * @code
+     * source.connect(rsig::mem_fun(&queued, &rsig::queued_signal<int>::emit));
+     * @endcode
+     */
+    template <typename... Args>
+    class queued_signal
+    {
+    public:
+        queued_signal();
+        ~queued_signal();
+
+        /*!
+         * Connect an observer to the signal.
+         *
+         * @param fun the lambda function that will be called by drain.
+         * @return the connection for this observer
+         */
+        connection connect(const std::function<void(Args...)>& fun);
+
+        /*!
+         * Disconnect an observer.
+         *
+         * @param id the connection returned by connect
+         */
+        void disconnect(connection id);
+
+        /*!
+         * Queue a signal event.
+         *
+         * @param args the values of this signal event
+         */
+        void emit(Args... args);
+
+        //! The eventfd that is readable while events are queued.
+        int fd() const noexcept;
+
+        /*!
+         * Call the observers for all queued events.
+         *
+         * If an observer throws, the event it was called for is consumed
+         * and the later events stay queued for the next drain.
+         *
+         * @return the number of dispatched events
+         */
+        size_t drain();
+
+    private:
+        struct event
+        {
+            trace_context                       trace;
+            std::tuple<std::decay_t<Args>...>   args;
+        };
+
+        int                 efd = -1;
+        std::mutex          mutex;
+        std::vector<event>  pending;
+        // only touched by drain, keeps its capacity between batches
+        std::vector<event>  batch;
+        signal<Args...>     observers;
+
+        queued_signal(const queued_signal<Args...>&) = delete;
+        queued_signal<Args...>& operator = (const queued_signal<Args...>&) = delete;
+    };
+
+    template <typename... Args>
+    queued_signal<Args...>::queued_signal()
+    {
+        efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (efd == -1)
+        {
+            throw std::system_error(errno, std::generic_category(), "queued_signal: eventfd failed");
+        }
+    }
+
+    template <typename... Args>
+    queued_signal<Args...>::~queued_signal()
+    {
+        close(efd);
+    }
+
+    template <typename... Args>
+    connection queued_signal<Args...>::connect(const std::function<void(Args...)>& fun)
+    {
+        return observers.connect(fun);
+    }
+
+    template <typename... Args>
+    void queued_signal<Args...>::disconnect(connection id)
+    {
+        observers.disconnect(id);
+    }
+
+    template <typename... Args>
+    void queued_signal<Args...>::emit(Args... args)
+    {
+        auto was_empty = false;
+        {
+            std::scoped_lock<std::mutex> sl(mutex);
+            was_empty = pending.empty();
+            pending.push_back({current_trace(), {args...}});
+        }
+
+        if (was_empty)
+        {
+            auto one = std::uint64_t{1};
+            while (write(efd, &one, sizeof(one)) == -1 && errno == EINTR) {}
+        }
+    }
+
+    template <typename... Args>
+    int queued_signal<Args...>::fd() const noexcept
+    {
+        return efd;
+    }
+
+    template <typename... Args>
+    size_t queued_signal<Args...>::drain()
+    {
+        // reset the eventfd before taking the events, so that an event
+        // queued after the swap signals the eventfd again
+        auto value = std::uint64_t{0};
+        while (read(efd, &value, sizeof(value)) == -1 && errno == EINTR) {}
+
+        {
+            std::scoped_lock<std::mutex> sl(mutex);
+            std::swap(pending, batch);
+        }
+
+        auto i = begin(batch);
+        try
+        {
+            for (; i != end(batch); ++i)
+            {
+                trace_scope scope(i->trace);
+                std::apply([this] (auto&... args) {
+                    observers.emit(args...);
+                }, i->args);
+            }
+        }
+        catch (...)
+        {
+            // the event that threw is consumed, the ones after it go back
+            // to the front of the queue for the next drain
+            auto left = false;
+            {
+                std::scoped_lock<std::mutex> sl(mutex);
+                pending.insert(begin(pending), std::make_move_iterator(std::next(i)), std::make_move_iterator(end(batch)));
+                left = !pending.empty();
+            }
+            batch.clear();
+            if (left)
+            {
+                auto one = std::uint64_t{1};
+                while (write(efd, &one, sizeof(one)) == -1 && errno == EINTR) {}
+            }
+            throw;
+        }
+
+        auto count = batch.size();
+        batch.clear();
+        return count;
+    }
+}
+
+#endif
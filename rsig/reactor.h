@@ -0,0 +1,413 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef _RSIG_REACTOR_H_
+#define _RSIG_REACTOR_H_
+
+#ifndef __linux__
+#error "rsig/reactor.h requires Linux."
+#endif
+
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "rsig.h"
+#include "queued_signal.h"
+
+namespace rsig
+{
+    /*!
+     * An epoll based event loop that emits signals.
+     *
+     * File descriptors and timers are registered with the reactor, which
+     * owns a signal for each of them. The thread that calls run or
+     * run_once waits for readiness and emits the signals directly,
+     * processing all ready sources of one epoll_wait as a batch.
+     *
+     * @note Sources can be added and removed from any thread and from
+     * inside observers. The signals are emitted on the reactor thread.
+     */
+    class reactor
+    {
+    public:
+        reactor();
+        ~reactor();
+
+        /*!
+         * Watch a file descriptor.
+         *
+         * @param fd the file descriptor, it is not owned by the reactor
+         * @param events the epoll events to wait for
+         * @return the signal that is emitted with the ready events
+         */
+        signal<std::uint32_t>& watch(int fd, std::uint32_t events = EPOLLIN);
+
+        /*!
+         * Stop watching a file descriptor.
+         *
+         * @param fd the file descriptor passed to watch
+         */
+        void unwatch(int fd);
+
+        /*!
+         * Add a timer.
+         *
+         * @param interval the time until the timer expires
+         * @param repeat whether the timer restarts after expiring
+         * @return the signal that is emitted with the number of expirations
+         */
+        signal<std::uint64_t>& add_timer(std::chrono::nanoseconds interval, bool repeat = true);
+
+        /*!
+         * Remove a timer.
+         *
+         * @param timer the signal returned by add_timer
+         */
+        void remove_timer(const signal<std::uint64_t>& timer);
+
+        /*!
+         * Drain a queued signal on the reactor thread.
+         *
+         * @param queued the queued signal, it must outlive the registration
+         */
+        template <typename... Args>
+        void watch(queued_signal<Args...>& queued);
+
+        /*!
+         * Stop draining a queued signal.
+         *
+         * @param queued the queued signal passed to watch
+         */
+        template <typename... Args>
+        void unwatch(queued_signal<Args...>& queued);
+
+        /*!
+         * Wait for ready sources once and emit their signals.
+         *
+         * @param timeout the maximum time to wait, negative waits forever
+         * @return the number of handled sources
+         */
+        size_t run_once(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1));
+
+        //! Run the loop until stop is called, or return if it was called since the last run.
+        void run();
+
+        //! Make run return, can be called from any thread.
+        void stop();
+
+    private:
+        struct source
+        {
+            int                                     fd = -1;
+            bool                                    owned = false;
+            const void*                             key = nullptr;
+            std::function<void (std::uint32_t)>     handle;
+            std::unique_ptr<signal<std::uint32_t>>  ready;
+            std::unique_ptr<signal<std::uint64_t>>  timer;
+        };
+
+        int                 epoll  = -1;
+        int                 wakeup = -1;
+        std::atomic<bool>   stopped = false;
+
+        std::mutex          mutex;
+        std::uint64_t       last_id = 0;
+        std::unordered_map<std::uint64_t, std::unique_ptr<source>> sources;
+        std::unordered_map<int, std::uint64_t>                    by_fd;
+        // removed while the reactor may still emit them, freed after the batch
+        std::vector<std::unique_ptr<source>>                      retired;
+
+        source& add(std::unique_ptr<source> s, std::uint32_t events);
+        void remove(int fd);
+
+        reactor(const reactor&) = delete;
+        reactor& operator = (const reactor&) = delete;
+    };
+
+    inline reactor::reactor()
+    {
+        epoll = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll == -1)
+        {
+            throw std::system_error(errno, std::generic_category(), "reactor: epoll_create1 failed");
+        }
+        wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeup == -1)
+        {
+            auto error = errno;
+            close(epoll);
+            throw std::system_error(error, std::generic_category(), "reactor: eventfd failed");
+        }
+
+        // id 0 is the wakeup eventfd
+        auto ev = epoll_event{};
+        ev.events   = EPOLLIN;
+        ev.data.u64 = 0;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, wakeup, &ev);
+    }
+
+    inline reactor::~reactor()
+    {
+        for (auto& [id, s] : sources)
+        {
+            if (s->owned)
+            {
+                close(s->fd);
+            }
+        }
+        for (auto& s : retired)
+        {
+            if (s->owned)
+            {
+                close(s->fd);
+            }
+        }
+        close(wakeup);
+        close(epoll);
+    }
+
+    inline signal<std::uint32_t>& reactor::watch(int fd, std::uint32_t events)
+    {
+        auto s = std::make_unique<source>();
+        s->fd    = fd;
+        s->ready = std::make_unique<signal<std::uint32_t>>();
+        s->handle = [sig = s->ready.get()] (std::uint32_t ev) {
+            sig->emit(ev);
+        };
+        return *add(std::move(s), events).ready;
+    }
+
+    inline void reactor::unwatch(int fd)
+    {
+        remove(fd);
+    }
+
+    inline signal<std::uint64_t>& reactor::add_timer(std::chrono::nanoseconds interval, bool repeat)
+    {
+        auto fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (fd == -1)
+        {
+            throw std::system_error(errno, std::generic_category(), "reactor: timerfd_create failed");
+        }
+
+        auto spec = itimerspec{};
+        spec.it_value.tv_sec  = static_cast<time_t>(interval.count() / 1000000000);
+        spec.it_value.tv_nsec = static_cast<long>(interval.count() % 1000000000);
+        if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0)
+        {
+            // a zero value disarms the timer
+            spec.it_value.tv_nsec = 1;
+        }
+        if (repeat)
+        {
+            spec.it_interval = spec.it_value;
+        }
+        if (timerfd_settime(fd, 0, &spec, nullptr) != 0)
+        {
+            auto error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "reactor: timerfd_settime failed");
+        }
+
+        auto s = std::make_unique<source>();
+        s->fd    = fd;
+        s->owned = true;
+        s->timer = std::make_unique<signal<std::uint64_t>>();
+        s->key   = s->timer.get();
+        s->handle = [fd, sig = s->timer.get()] (std::uint32_t) {
+            auto expirations = std::uint64_t{0};
+            if (read(fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+            {
+                sig->emit(expirations);
+            }
+        };
+        return *add(std::move(s), EPOLLIN).timer;
+    }
+
+    inline void reactor::remove_timer(const signal<std::uint64_t>& timer)
+    {
+        auto fd = -1;
+        {
+            std::scoped_lock<std::mutex> sl(mutex);
+            for (auto& [id, s] : sources)
+            {
+                if (s->key == &timer)
+                {
+                    fd = s->fd;
+                    break;
+                }
+            }
+        }
+        if (fd == -1)
+        {
+            throw std::invalid_argument("reactor::remove_timer: unknown timer");
+        }
+        remove(fd);
+    }
+
+    template <typename... Args>
+    void reactor::watch(queued_signal<Args...>& queued)
+    {
+        auto s = std::make_unique<source>();
+        s->fd  = queued.fd();
+        s->key = &queued;
+        s->handle = [&queued] (std::uint32_t) {
+            queued.drain();
+        };
+        add(std::move(s), EPOLLIN);
+    }
+
+    template <typename... Args>
+    void reactor::unwatch(queued_signal<Args...>& queued)
+    {
+        remove(queued.fd());
+    }
+
+    inline size_t reactor::run_once(std::chrono::milliseconds timeout)
+    {
+        constexpr auto batch_size = 64;
+        epoll_event events[batch_size];
+
+        auto n = epoll_wait(epoll, events, batch_size, static_cast<int>(timeout.count()));
+        if (n == -1)
+        {
+            if (errno == EINTR)
+            {
+                return 0;
+            }
+            throw std::system_error(errno, std::generic_category(), "reactor: epoll_wait failed");
+        }
+
+        auto count = size_t{0};
+        for (auto i = 0; i < n; i++)
+        {
+            if (events[i].data.u64 == 0)
+            {
+                auto value = std::uint64_t{0};
+                while (read(wakeup, &value, sizeof(value)) == -1 && errno == EINTR) {}
+                continue;
+            }
+
+            source* s = nullptr;
+            {
+                std::scoped_lock<std::mutex> sl(mutex);
+                auto j = sources.find(events[i].data.u64);
+                if (j != end(sources))
+                {
+                    s = j->second.get();
+                }
+            }
+            if (s != nullptr)
+            {
+                s->handle(events[i].events);
+                count++;
+            }
+        }
+
+        std::vector<std::unique_ptr<source>> done;
+        {
+            std::scoped_lock<std::mutex> sl(mutex);
+            std::swap(done, retired);
+        }
+        for (auto& s : done)
+        {
+            if (s->owned)
+            {
+                close(s->fd);
+            }
+        }
+        return count;
+    }
+
+    inline void reactor::run()
+    {
+        // a stop that came before run is kept and makes run return at once
+        while (!stopped.exchange(false))
+        {
+            run_once();
+        }
+    }
+
+    inline void reactor::stop()
+    {
+        stopped = true;
+        auto one = std::uint64_t{1};
+        while (write(wakeup, &one, sizeof(one)) == -1 && errno == EINTR) {}
+    }
+
+    inline reactor::source& reactor::add(std::unique_ptr<source> s, std::uint32_t events)
+    {
+        std::scoped_lock<std::mutex> sl(mutex);
+        if (by_fd.count(s->fd) != 0)
+        {
+            if (s->owned)
+            {
+                close(s->fd);
+            }
+            throw std::invalid_argument("reactor: file descriptor is already registered");
+        }
+
+        auto id = ++last_id;
+        auto ev = epoll_event{};
+        ev.events   = events;
+        ev.data.u64 = id;
+        if (epoll_ctl(epoll, EPOLL_CTL_ADD, s->fd, &ev) != 0)
+        {
+            auto error = errno;
+            if (s->owned)
+            {
+                close(s->fd);
+            }
+            throw std::system_error(error, std::generic_category(), "reactor: epoll_ctl failed");
+        }
+
+        by_fd[s->fd] = id;
+        auto& result = *s;
+        sources[id] = std::move(s);
+        return result;
+    }
+
+    inline void reactor::remove(int fd)
+    {
+        std::scoped_lock<std::mutex> sl(mutex);
+        auto i = by_fd.find(fd);
+        if (i == end(by_fd))
+        {
+            throw std::invalid_argument("reactor: file descriptor is not registered");
+        }
+
+        epoll_ctl(epoll, EPOLL_CTL_DEL, fd, nullptr);
+        auto j = sources.find(i->second);
+        retired.push_back(std::move(j->second));
+        sources.erase(j);
+        by_fd.erase(i);
+    }
+}
+
+#endif
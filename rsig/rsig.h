@@ -24,13 +24,462 @@
 #ifndef _RSIG_SIGNAL_H_
 #define _RSIG_SIGNAL_H_
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <exception>
 #include <functional>
-#include <map>
+#include <memory>
 #include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#if defined(__has_include)
+#if __has_include(<version>)
+#include <version>
+#endif
+#endif
+
+// keyed on jthread, libc++ ships stop_token together with it
+#if defined(__cpp_lib_jthread)
+#include <stop_token>
+#define RSIG_STOP_TOKEN
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RSIG_SSE2
+#endif
 
 namespace rsig
 {
+    //! Category mask that matches every category.
+    constexpr std::uint64_t all_categories = ~std::uint64_t{0};
+
+    namespace detail
+    {
+        //! Call fun(i) for every i where masks[i] and filter share a bit.
+        //!
+        //! The masks are tested in SIMD lanes, so that runs of observers that
+        //! are not interested in the categories are skipped without touching
+        //! their functions.
+        template <typename Fun>
+        void scan_masks(const std::uint64_t* masks, size_t count, std::uint64_t filter, Fun&& fun)
+        {
+            size_t i = 0;
+#if defined(__AVX2__)
+            const auto f    = _mm256_set1_epi64x(static_cast<long long>(filter));
+            const auto zero = _mm256_setzero_si256();
+            for (; i + 4 <= count; i += 4)
+            {
+                auto m    = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(masks + i));
+                auto none = _mm256_cmpeq_epi64(_mm256_and_si256(m, f), zero);
+                auto hits = ~_mm256_movemask_pd(_mm256_castsi256_pd(none)) & 0xF;
+                for (auto j = 0u; hits != 0; j++, hits >>= 1)
+                {
+                    if (hits & 1)
+                    {
+                        fun(i + j);
+                    }
+                }
+            }
+#elif defined(RSIG_SSE2)
+            const auto f    = _mm_set1_epi64x(static_cast<long long>(filter));
+            const auto zero = _mm_setzero_si128();
+            for (; i + 2 <= count; i += 2)
+            {
+                auto m    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks + i));
+                auto none = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(m, f), zero));
+                if ((none & 0x00FF) != 0x00FF)
+                {
+                    fun(i);
+                }
+                if ((none & 0xFF00) != 0xFF00)
+                {
+                    fun(i + 1);
+                }
+            }
+#endif
+            for (; i < count; i++)
+            {
+                if ((masks[i] & filter) != 0)
+                {
+                    fun(i);
+                }
+            }
+        }
+
+        //! Boolean that is read and written with relaxed ordering.
+        //!
+        //! Unlike std::atomic<bool> this can be copied, so that it can live in
+        //! the observer vector.
+        class relaxed_flag
+        {
+        public:
+            relaxed_flag(bool v = false) noexcept
+            : value(v) {}
+
+            relaxed_flag(const relaxed_flag& other) noexcept
+            : value(other.get()) {}
+
+            relaxed_flag& operator = (const relaxed_flag& other) noexcept
+            {
+                set(other.get());
+                return *this;
+            }
+
+            bool get() const noexcept
+            {
+                return value.load(std::memory_order_relaxed);
+            }
+
+            void set(bool v) noexcept
+            {
+                value.store(v, std::memory_order_relaxed);
+            }
+
+            bool exchange(bool v) noexcept
+            {
+                return value.exchange(v, std::memory_order_relaxed);
+            }
+
+        private:
+            std::atomic<bool> value;
+        };
+
+        //! The lock free reads in progress on one thread.
+        //!
+        //! Every thread that reads gets its own record on its own cache
+        //! line, so frozen emits on different threads do not write to a
+        //! shared counter. Records of finished threads are reused and never
+        //! freed.
+        struct alignas(64) reader_record
+        {
+            static constexpr size_t max_depth = 16;
+
+            // odd while the thread reads, a writer waits for it to change
+            std::atomic<std::uint64_t>  seq = 0;
+            // the object read at each nesting depth
+            std::atomic<const void*>    owners[max_depth] = {};
+            // set while reads are nested deeper, they may read anything
+            std::atomic<bool>           deep = false;
+            // only touched by the thread that uses the record
+            size_t                      depth = 0;
+            std::atomic<bool>           used  = true;
+            reader_record*              next  = nullptr;
+        };
+
+        inline std::atomic<reader_record*>& reader_records() noexcept
+        {
+            static std::atomic<reader_record*> head = nullptr;
+            return head;
+        }
+
+        inline reader_record*& this_reader() noexcept
+        {
+            thread_local reader_record* record = nullptr;
+            return record;
+        }
+
+        //! Hands the record back when the thread ends.
+        struct reader_release
+        {
+            ~reader_release()
+            {
+                this_reader()->used.store(false, std::memory_order_release);
+                this_reader() = nullptr;
+            }
+        };
+
+        inline reader_record& acquire_reader()
+        {
+            auto& head = reader_records();
+            auto record = static_cast<reader_record*>(nullptr);
+            for (auto r = head.load(std::memory_order_acquire); r != nullptr && record == nullptr; r = r->next)
+            {
+                auto expected = false;
+                if (!r->used.load(std::memory_order_relaxed) &&
+                    r->used.compare_exchange_strong(expected, true, std::memory_order_acquire, std::memory_order_relaxed))
+                {
+                    record = r;
+                }
+            }
+            if (record == nullptr)
+            {
+                record = new reader_record;
+                record->next = head.load(std::memory_order_relaxed);
+                while (!head.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed)) {}
+            }
+
+            this_reader() = record;
+            thread_local reader_release release;
+            return *record;
+        }
+
+        //! Check if the current thread is reading the data of owner.
+        inline bool is_reading(const void* owner) noexcept
+        {
+            auto record = this_reader();
+            if (record == nullptr)
+            {
+                return false;
+            }
+            if (record->depth > reader_record::max_depth)
+            {
+                return true;
+            }
+            for (auto i = size_t{0}; i < record->depth; i++)
+            {
+                if (record->owners[i].load(std::memory_order_relaxed) == owner)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //! Wait until a counter is zero.
+        inline void wait_idle(const std::atomic<size_t>& counter) noexcept
+        {
+            for (auto n = counter.load(std::memory_order_acquire); n != 0; n = counter.load(std::memory_order_acquire))
+            {
+                counter.wait(n, std::memory_order_acquire);
+            }
+        }
+
+        //! Wait for the reads of owner on other threads.
+        //!
+        //! Data that was unpublished before the call is not read by any
+        //! thread once this returns.
+        inline void wait_readers(const void* owner) noexcept
+        {
+            // pairs with the exchange in read_guard, either the reader is
+            // seen or it sees the unpublished data gone
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto self = this_reader();
+            for (auto r = reader_records().load(std::memory_order_acquire); r != nullptr; r = r->next)
+            {
+                if (r == self)
+                {
+                    continue;
+                }
+                auto reading = r->deep.load(std::memory_order_acquire);
+                for (auto& o : r->owners)
+                {
+                    reading = reading || o.load(std::memory_order_acquire) == owner;
+                }
+                if (!reading)
+                {
+                    continue;
+                }
+                auto seq = r->seq.load(std::memory_order_acquire);
+                for (auto spins = 0u; seq % 2 == 1 && r->seq.load(std::memory_order_acquire) == seq; spins++)
+                {
+                    if (spins < 64u)
+                    {
+                        std::this_thread::yield();
+                    }
+                    else
+                    {
+                        std::this_thread::sleep_for(std::chrono::microseconds(50));
+                    }
+                }
+            }
+        }
+
+        //! Marks a lock free read of owner on the current thread.
+        //!
+        //! Only the record of the current thread is written. Reads nested
+        //! deeper than max_depth are not told apart, writers wait for them
+        //! whatever they read.
+        class read_guard
+        {
+        public:
+            explicit read_guard(const void* owner)
+            : record(this_reader())
+            {
+                if (record == nullptr)
+                {
+                    record = &acquire_reader();
+                }
+                depth = record->depth++;
+                if (depth == 0)
+                {
+                    record->seq.store(record->seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                }
+                if (depth < reader_record::max_depth)
+                {
+                    record->owners[depth].exchange(owner, std::memory_order_seq_cst);
+                }
+                else if (depth == reader_record::max_depth)
+                {
+                    record->deep.exchange(true, std::memory_order_seq_cst);
+                }
+            }
+
+            ~read_guard()
+            {
+                record->depth = depth;
+                if (depth < reader_record::max_depth)
+                {
+                    record->owners[depth].store(nullptr, std::memory_order_release);
+                }
+                else if (depth == reader_record::max_depth)
+                {
+                    record->deep.store(false, std::memory_order_release);
+                }
+                if (depth == 0)
+                {
+                    record->seq.store(record->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+                }
+            }
+
+        private:
+            reader_record*  record;
+            size_t          depth = 0;
+
+            read_guard(const read_guard&) = delete;
+            read_guard& operator = (const read_guard&) = delete;
+        };
+
+        //! Locks a mutex, a thread that has to wait for it is counted in
+        //! counter until it released the lock again.
+        class counted_lock
+        {
+        public:
+            counted_lock(std::mutex& m, std::atomic<size_t>& c)
+            : mutex(m)
+            {
+                if (!mutex.try_lock())
+                {
+                    counter = &c;
+                    counter->fetch_add(1, std::memory_order_relaxed);
+                    try
+                    {
+                        mutex.lock();
+                    }
+                    catch (...)
+                    {
+                        release();
+                        throw;
+                    }
+                }
+            }
+
+            ~counted_lock()
+            {
+                mutex.unlock();
+                release();
+            }
+
+        private:
+            std::mutex&             mutex;
+            std::atomic<size_t>*    counter = nullptr;
+
+            void release() noexcept
+            {
+                if (counter != nullptr && counter->fetch_sub(1, std::memory_order_release) == 1)
+                {
+                    counter->notify_all();
+                }
+            }
+
+            counted_lock(const counted_lock&) = delete;
+            counted_lock& operator = (const counted_lock&) = delete;
+        };
+
+        //! Counts a thread in counter while it lives.
+        class count_guard
+        {
+        public:
+            explicit count_guard(std::atomic<size_t>& c) noexcept
+            : counter(c)
+            {
+                counter.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            ~count_guard()
+            {
+                if (counter.fetch_sub(1, std::memory_order_release) == 1)
+                {
+                    counter.notify_all();
+                }
+            }
+
+        private:
+            std::atomic<size_t>& counter;
+
+            count_guard(const count_guard&) = delete;
+            count_guard& operator = (const count_guard&) = delete;
+        };
+    }
+
+    /*!
+     * Trace context of the current emission.
+     *
+     * The context lives in thread local storage, so emits from observers
+     * inherit it. When rsig hands an emission to another thread, like
+     * queued_signal, stage or emit_combining, the context is carried along
+     * and restored around the observer calls.
+     */
+    struct trace_context
+    {
+        std::uint64_t                           trace_id = 0;   //!< the trace, 0 if none
+        std::uint64_t                           span_id  = 0;   //!< the span within the trace
+        std::chrono::steady_clock::time_point   origin;         //!< when the trace started
+    };
+
+    namespace detail
+    {
+        inline trace_context& trace_slot() noexcept
+        {
+            thread_local trace_context current;
+            return current;
+        }
+    }
+
+    //! The trace context of the calling thread.
+    inline const trace_context& current_trace() noexcept
+    {
+        return detail::trace_slot();
+    }
+
+    /*!
+     * Set the trace context of the calling thread for a scope.
+     *
+     * Example:
+     * @code
+     * rsig::trace_scope scope({next_trace_id(), 1, std::chrono::steady_clock::now()});
+     * input_signal.emit(packet);
+     * @endcode
+     */
+    class trace_scope
+    {
+    public:
+        explicit trace_scope(const trace_context& context) noexcept
+        : previous(detail::trace_slot())
+        {
+            detail::trace_slot() = context;
+        }
+
+        ~trace_scope()
+        {
+            detail::trace_slot() = previous;
+        }
+
+    private:
+        trace_context previous;
+
+        trace_scope(const trace_scope&) = delete;
+        trace_scope& operator = (const trace_scope&) = delete;
+    };
+
     /*!
      * Handle to a signal / observer connection.
      *
@@ -42,6 +491,53 @@ namespace rsig
         void* signal = nullptr;
     };
 
+    /*!
+     * A group of observers that can be blocked together.
+     *
+     * Observers are put into a group when they are connected. Blocking the
+     * group mutes all of them with one store, without touching the signals
+     * they are connected to.
+     *
+     * @note The group must outlive the connections made with it.
+     */
+    class group
+    {
+    public:
+        group() = default;
+        ~group() = default;
+
+        //! Stop calling the observers of this group.
+        void block() noexcept
+        {
+            blocked.set(true);
+        }
+
+        //! Resume calling the observers of this group.
+        void unblock() noexcept
+        {
+            blocked.set(false);
+        }
+
+        //! Check if the group is blocked.
+        bool is_blocked() const noexcept
+        {
+            return blocked.get();
+        }
+
+    private:
+        detail::relaxed_flag blocked;
+
+        group(const group&) = delete;
+        group& operator = (const group&) = delete;
+    };
+
+    //! Counters of a signal.
+    struct signal_stats
+    {
+        size_t freezes = 0; //!< times the signal was frozen
+        size_t thaws   = 0; //!< times a change thawed the frozen signal
+    };
+
     /*!
      * A thread safe signal multiplexer.
      *
@@ -50,94 +546,1000 @@ namespace rsig
      * emits the signal is the same that will call the functions. The signal
      * is secured by a mutex, thus it may create contention when emitting
      * a signal with a function that runs long.
+     *
+     * @note Destroying the signal waits for the emits that run on other
+     * threads to return. Emits that wait for the lock when the destructor
+     * starts do not call the observers and return 0. The signal must not
+     * be destroyed from its own observers.
      */
     template <typename... Args>
     class signal
     {
     public:
         signal() = default;
-        ~signal() = default;
+        ~signal();
 
         /*!
          * Connect an observer to the signal.
          *
          * @param fun the lambda function that will be called when emit is called.
+         * @param mask the categories this observer is interested in
          * @return the connection for this observer
          *
+         * @note Connecting to a frozen signal thaws it.
+         *
          * @warning If the context, like lambda captures, lifetime is shorter
          * than the signal, the observer must be disconnected.
          */
-        connection connect(const std::function<void(Args...)>& fun);
+        connection connect(const std::function<void(Args...)>& fun, std::uint64_t mask = all_categories);
+
+        /*!
+         * Connect an observer to the signal as part of a group.
+         *
+         * @param fun the lambda function that will be called when emit is called.
+         * @param grp the group the observer belongs to
+         * @param mask the categories this observer is interested in
+         * @return the connection for this observer
+         */
+        connection connect(const std::function<void(Args...)>& fun, const group& grp, std::uint64_t mask = all_categories);
+
+        /*!
+         * Connect a function pointer with a context to the signal.
+         *
+         * The function is called directly, without going through
+         * std::function. This is the observer form used by the C interface.
+         *
+         * @param fun the function that will be called when emit is called.
+         * @param context the first argument passed to fun
+         * @param mask the categories this observer is interested in
+         * @return the connection for this observer
+         */
+        connection connect(void (*fun)(void*, Args...), void* context, std::uint64_t mask = all_categories);
+
+        /*!
+         * Connect a member function of a tracked object to the signal.
+         *
+         * The observer holds only a weak reference to the object. Once the
+         * object is destroyed, the observer is no longer called and is
+         * removed from the signal during the next emit.
+         *
+         * @param that the object to track
+         * @param method the class method to call
+         * @param mask the categories this observer is interested in
+         * @return the connection for this observer
+         *
+         * Example:
+         * @code
+         * some_signal.connect(std::weak_ptr<MyClass>(my_object), &MyClass::my_method);
+         * @endcode
+         */
+        template <typename Class, typename Method>
+        connection connect(const std::weak_ptr<Class>& that, Method method, std::uint64_t mask = all_categories);
+
+        /*!
+         * Connect many observers at once.
+         *
+         * All functions are checked before any is connected, then they are
+         * appended under one lock, in the order of the range.
+         *
+         * @param funs the range of functions
+         * @param out where the connections are written, in the order of funs
+         * @param mask the categories these observers are interested in
+         * @return the output iterator past the last written connection
+         *
+         * Example:
+         * @code
+         * std::vector<rsig::connection> connections;
+         * some_signal.connect_bulk(handlers, std::back_inserter(connections));
+         * @endcode
+         */
+        template <typename Range, typename OutputIt>
+        OutputIt connect_bulk(const Range& funs, OutputIt out, std::uint64_t mask = all_categories);
+
+        /*!
+         * Connect an observer that is called only once.
+         *
+         * The observer is removed from the signal by the emit that calls it.
+         * Until then it can be disconnected like any other observer.
+         *
+         * @param fun the lambda function that will be called when emit is called.
+         * @param mask the categories this observer is interested in
+         * @return the connection for this observer
+         */
+        connection connect_once(const std::function<void(Args...)>& fun, std::uint64_t mask = all_categories);
+
+#ifdef RSIG_STOP_TOKEN
+        /*!
+         * Connect an observer that is cancelled by a stop token.
+         *
+         * Once stop is requested on the token, the observer is no longer
+         * called and is removed from the signal during the next emit. There
+         * is no need to keep the connection around to disconnect it.
+         *
+         * @param fun the lambda function that will be called when emit is called.
+         * @param token the stop token that cancels the observer
+         * @param mask the categories this observer is interested in
+         * @return the connection for this observer
+         *
+         * @note Only available when the standard library has std::jthread.
+         */
+        connection connect(const std::function<void(Args...)>& fun, std::stop_token token, std::uint64_t mask = all_categories);
+#endif
+
+        /*!
+         * Forward the events of this signal to another signal.
+         *
+         * The target is emitted after this signal has released its lock,
+         * so no two signal locks are held at once, and the arguments are
+         * passed on by reference. A masked emit is only forwarded if the
+         * mask shares a bit with the given mask and the target is then
+         * emitted with the same mask.
+         *
+         * @param target the signal to emit
+         * @param mask the categories to forward
+         * @return the connection for this forward
+         *
+         * @note The target must outlive the connection and forwards must
+         * not form a cycle. Forwards can not be blocked.
+         */
+        connection forward(const signal<Args...>& target, std::uint64_t mask = all_categories);
 
         /*!
          * Disconnect an observer.
          *
          * @param id the connection returned by connect
+         *
+         * @note Disconnecting from a frozen signal thaws it and waits for
+         * the emits on other threads that still use the frozen observers.
+         * When called from an observer of a frozen emit, those emits may
+         * still call the disconnected observer.
          */
         void disconnect(connection id);
 
+        /*!
+         * Replace the function of an observer.
+         *
+         * The observer keeps its connection, position, categories and
+         * blocked state. Emits that already run may still call the old
+         * function.
+         *
+         * @param id the connection returned by connect
+         * @param fun the lambda function that will be called from now on.
+         *
+         * @note Replacing an observer of a frozen signal thaws it and waits
+         * like disconnect.
+         */
+        void replace(connection id, const std::function<void(Args...)>& fun);
+
+        /*!
+         * Temporarily stop calling an observer.
+         *
+         * Unlike disconnect, the observer keeps its connection and position.
+         *
+         * @param id the connection returned by connect
+         */
+        void block(connection id);
+
+        /*!
+         * Resume calling a blocked observer.
+         *
+         * @param id the connection returned by connect
+         */
+        void unblock(connection id);
+
         /*!
          * Emit a signal.
          *
          * Calls all observer functions with the given arguments and returns
-         * the number of called functions.
+         * the number of called functions. Blocked observers are skipped.
+         * Forwarded signals are emitted after the observers and their
+         * called functions are included in the count.
          *
          * @param args the values of this signal event
          * @return the number of called functions
          */
         size_t emit(Args... args) const;
 
+        /*!
+         * Emit a signal to a subset of observers.
+         *
+         * Only observers whose category mask shares at least one bit with
+         * the given mask are called.
+         *
+         * @param mask the categories of this signal event
+         * @param args the values of this signal event
+         * @return the number of called functions
+         */
+        size_t emit(std::uint64_t mask, Args... args) const;
+
+        /*!
+         * Emit a signal, combining emissions under contention.
+         *
+         * If the signal is busy, the emission is queued and the thread that
+         * holds the lock calls the observers for all queued emissions in
+         * one batch, while the observer data is warm in its cache. The call
+         * returns once the observers were called for this emission; an
+         * exception thrown by an observer is rethrown to the emitter whose
+         * emission it belongs to.
+         *
+         * @param args the values of this signal event
+         * @return the number of called functions
+         *
+         * @note The observers of combined emissions run on the combining
+         * thread. Use emit if observers rely on the emitting thread.
+         */
+        size_t emit_combining(Args... args) const;
+
+        /*!
+         * Freeze the observers into an immutable dispatch table.
+         *
+         * Until the signal is thawed, emit calls the observers from the
+         * table without taking the lock. A frozen emit only writes a record
+         * of its own thread, so emits on many threads do not contend.
+         * Blocking and unblocking keep the
+         * signal frozen; connecting, forwarding or disconnecting thaws it,
+         * which is counted in the stats.
+         *
+         * Freeze a signal once it is wired, for example after startup.
+         */
+        void freeze();
+
+        //! Check if the signal is frozen.
+        bool is_frozen() const noexcept;
+
+        //! Get the counters of this signal.
+        signal_stats get_stats() const;
+
     private:
+        struct observer
+        {
+            observer(std::function<void (Args...)> f)
+            : fun(std::move(f)) {}
+
+            observer(void (*f)(void*, Args...), void* c)
+            : raw(f), context(c) {}
+
+            size_t                          id = 0;
+            std::function<void (Args...)>   fun;
+            void                            (*raw)(void*, Args...) = nullptr;
+            void*                           context = nullptr;
+            const group*                    grp = nullptr;
+            bool                            once    = false;
+            bool                            tracked = false;
+            std::weak_ptr<const void>       life;
+#ifdef RSIG_STOP_TOKEN
+            std::stop_token                 token;
+#endif
+            detail::relaxed_flag            blocked;
+            detail::relaxed_flag            dead;
+            // only fun and the flags above matter, see invoke
+            bool                            plain = false;
+        };
+
+        struct forward_target
+        {
+            size_t                          id = 0;
+            const signal<Args...>*          target = nullptr;
+            std::uint64_t                   mask = all_categories;
+        };
+
+        // lives on the stack of the emitter until done is set
+        struct combine_request
+        {
+            std::tuple<Args&...>                                args;
+            trace_context                                       trace;
+            size_t                                              count = 0;
+            std::exception_ptr                                  error   = {};
+            std::shared_ptr<const std::vector<forward_target>>  targets = {};
+            combine_request*                                    next = nullptr;
+            std::atomic<bool>                                   done = false;
+        };
+
+        struct frozen_table
+        {
+            std::vector<observer>                               observers;
+            std::vector<std::uint64_t>                          masks;
+            std::shared_ptr<const std::vector<forward_target>>  forwards;
+        };
+
         mutable
         std::mutex mutex;
         size_t last_id = 0;
-        std::map<size_t, std::function<void (Args...)>> observers;
+        // observers are ordered by id, masks is kept parallel to observers
+        mutable std::vector<observer>      observers;
+        mutable std::vector<std::uint64_t> masks;
+        // observers marked dead during emit, removed before emit returns
+        mutable std::atomic<size_t> dead_count = 0;
+        // replaced on change, emit keeps a reference while it forwards
+        std::shared_ptr<const std::vector<forward_target>> forwards;
+
+        // the table emit uses without the lock, it is a copy of observers
+        std::atomic<frozen_table*> frozen = nullptr;
+        std::unique_ptr<frozen_table> frozen_owner;
+        // thawed tables, freed by drain once no emit reads them
+        std::vector<std::unique_ptr<frozen_table>> retired;
+        // emits waiting for the lock or a combined emission, the
+        // destructor waits for them
+        mutable std::atomic<size_t> waiting = 0;
+        // set by the destructor, emits that get the lock later return 0
+        bool closed = false;
+        signal_stats stats;
+        // emissions waiting for the thread that holds the lock
+        mutable std::atomic<combine_request*> pending = nullptr;
+
+        connection add(observer o, std::uint64_t mask);
+        size_t dispatch(bool masked, std::uint64_t mask, Args&... args) const;
+        size_t call(std::vector<observer>& obs, const std::vector<std::uint64_t>& m, bool masked, std::uint64_t mask, Args&... args) const;
+        static size_t call_forwards(const std::vector<forward_target>* targets, bool masked, std::uint64_t mask, Args&... args);
+        void combine() const;
+        void thaw();
+        void drain();
+        void mark_dead(observer& o) const;
+        typename std::vector<observer>::iterator find(connection id, const char* what);
+        bool invoke(observer& o, Args&... args) const;
+        bool invoke_special(observer& o, Args&... args) const;
+        static bool is_plain(const observer& o) noexcept;
+        void reap() const;
 
         signal(const signal<Args...>&) = delete;
         signal<Args...>& operator = (const signal<Args...>&) = delete;
     };
 
     template <typename... Args>
-    connection signal<Args...>::connect(const std::function<void(Args...)>& fun)
+    signal<Args...>::~signal()
     {
+        {
+            // emits that hold the lock return first, queued emissions are run
+            std::scoped_lock<std::mutex> sl(mutex);
+            combine();
+            closed = true;
+            frozen.store(nullptr, std::memory_order_seq_cst);
+        }
+        // emits that read the frozen table, then the emits that wait for
+        // the lock; one that took the free lock in between releases it here
+        detail::wait_readers(this);
+        do
+        {
+            detail::wait_idle(waiting);
+            std::scoped_lock<std::mutex> sl(mutex);
+        }
+        while (waiting.load(std::memory_order_acquire) != 0);
+    }
+
+    template <typename... Args>
+    connection signal<Args...>::connect(const std::function<void(Args...)>& fun, std::uint64_t mask)
+    {
+        return add(observer{fun}, mask);
+    }
+
+    template <typename... Args>
+    connection signal<Args...>::connect(const std::function<void(Args...)>& fun, const group& grp, std::uint64_t mask)
+    {
+        auto o = observer{fun};
+        o.grp = &grp;
+        return add(std::move(o), mask);
+    }
+
+    template <typename... Args>
+    connection signal<Args...>::connect(void (*fun)(void*, Args...), void* context, std::uint64_t mask)
+    {
+        return add(observer{fun, context}, mask);
+    }
+
+    template <typename... Args>
+    template <typename Class, typename Method>
+    connection signal<Args...>::connect(const std::weak_ptr<Class>& that, Method method, std::uint64_t mask)
+    {
+        auto life = that.lock();
+        if (!life)
+        {
+            throw std::invalid_argument("Tracked object is expired.");
+        }
+
+        auto ptr = life.get();
+        auto o = observer{[ptr, method] (Args... args) {
+            (ptr->*method)(args...);
+        }};
+        o.tracked = true;
+        o.life    = that;
+        return add(std::move(o), mask);
+    }
+
+    template <typename... Args>
+    template <typename Range, typename OutputIt>
+    OutputIt signal<Args...>::connect_bulk(const Range& funs, OutputIt out, std::uint64_t mask)
+    {
+        std::vector<observer> added;
+        for (const auto& fun : funs)
+        {
+            auto o = observer{std::function<void (Args...)>(fun)};
+            if (!o.fun)
+            {
+                throw std::invalid_argument("Signal observer is invalid.");
+            }
+            added.push_back(std::move(o));
+        }
+
+        auto first = size_t{0};
+        {
+            std::scoped_lock<std::mutex> sl(mutex);
+            thaw();
+            observers.reserve(observers.size() + added.size());
+            masks.reserve(masks.size() + added.size());
+            first = last_id + 1;
+            for (auto& o : added)
+            {
+                o.id    = ++last_id;
+                o.plain = true;
+                observers.push_back(std::move(o));
+                masks.push_back(mask);
+            }
+        }
+
+        // the ids were taken in one go, so they are consecutive
+        for (auto i = size_t{0}; i < added.size(); i++)
+        {
+            *out++ = connection{first + i, this};
+        }
+        return out;
+    }
+
+    template <typename... Args>
+    connection signal<Args...>::connect_once(const std::function<void(Args...)>& fun, std::uint64_t mask)
+    {
+        auto o = observer{fun};
+        o.once = true;
+        return add(std::move(o), mask);
+    }
+
+#ifdef RSIG_STOP_TOKEN
+    template <typename... Args>
+    connection signal<Args...>::connect(const std::function<void(Args...)>& fun, std::stop_token token, std::uint64_t mask)
+    {
+        auto o = observer{fun};
+        o.token = std::move(token);
+        return add(std::move(o), mask);
+    }
+#endif
+
+    template <typename... Args>
+    connection signal<Args...>::forward(const signal<Args...>& target, std::uint64_t mask)
+    {
+        if (&target == this)
+        {
+            throw std::invalid_argument("signal::forward: can not forward to itself");
+        }
+
         std::scoped_lock<std::mutex> sl(mutex);
+        thaw();
+        auto next = forwards ? std::make_shared<std::vector<forward_target>>(*forwards)
+                             : std::make_shared<std::vector<forward_target>>();
+        next->push_back({++last_id, &target, mask});
+        forwards = std::move(next);
+        return {last_id, this};
+    }
+
+    template <typename... Args>
+    void signal<Args...>::disconnect(connection id)
+    {
+        {
+            std::scoped_lock<std::mutex> sl(mutex);
+            auto table = frozen.load(std::memory_order_relaxed);
+            thaw();
+            auto forwarded = false;
+            if (forwards && id.signal == this)
+            {
+                auto j = std::find_if(begin(*forwards), end(*forwards), [&] (const forward_target& f) {
+                    return f.id == id.id;
+                });
+                if (j != end(*forwards))
+                {
+                    auto next = std::make_shared<std::vector<forward_target>>(*forwards);
+                    next->erase(begin(*next) + std::distance(begin(*forwards), j));
+                    forwards = next->empty() ? nullptr : std::move(next);
+                    forwarded = true;
+                }
+            }
+
+            if (!forwarded)
+            {
+                auto i = find(id, "signal::disconnect: mismatched connection");
+                if (table != nullptr)
+                {
+                    // emits of this thread that still run on the table skip it
+                    auto k = std::lower_bound(begin(table->observers), end(table->observers), id.id, [] (const observer& o, size_t id) {
+                        return o.id < id;
+                    });
+                    k->dead.set(true);
+                }
+                masks.erase(begin(masks) + std::distance(begin(observers), i));
+                observers.erase(i);
+            }
+        }
+        drain();
+    }
+
+    template <typename... Args>
+    void signal<Args...>::replace(connection id, const std::function<void(Args...)>& fun)
+    {
         if (!fun)
         {
             throw std::invalid_argument("Signal observer is invalid.");
         }
 
-        auto id = ++last_id;
-        observers[id] = fun;
-        return {id, this};
+        {
+            std::scoped_lock<std::mutex> sl(mutex);
+            auto i = find(id, "signal::replace: mismatched connection");
+            // the frozen table calls the function without the lock
+            thaw();
+            i = find(id, "signal::replace: mismatched connection");
+            i->fun     = fun;
+            i->raw     = nullptr;
+            i->context = nullptr;
+            i->tracked = false;
+            i->life.reset();
+            i->plain   = is_plain(*i);
+        }
+        drain();
     }
 
     template <typename... Args>
-    void signal<Args...>::disconnect(connection id)
+    void signal<Args...>::block(connection id)
     {
-        if (id.signal != this)
+        std::scoped_lock<std::mutex> sl(mutex);
+        auto i = find(id, "signal::block: mismatched connection");
+        i->blocked.set(true);
+        if (auto table = frozen.load(std::memory_order_relaxed))
         {
-            throw std::invalid_argument("signal::disconnect: mismatched connection");
+            table->observers[static_cast<size_t>(std::distance(begin(observers), i))].blocked.set(true);
         }
+    }
 
+    template <typename... Args>
+    void signal<Args...>::unblock(connection id)
+    {
         std::scoped_lock<std::mutex> sl(mutex);
-        auto i = observers.find(id.id);
-        if (i == end(observers))
+        auto i = find(id, "signal::unblock: mismatched connection");
+        i->blocked.set(false);
+        if (auto table = frozen.load(std::memory_order_relaxed))
         {
-            throw std::runtime_error("No observer with this id.");
+            table->observers[static_cast<size_t>(std::distance(begin(observers), i))].blocked.set(false);
         }
-        observers.erase(i);
     }
 
     template <typename... Args>
     size_t signal<Args...>::emit(Args... args) const
+    {
+        return dispatch(false, all_categories, args...);
+    }
+
+    template <typename... Args>
+    size_t signal<Args...>::emit(std::uint64_t mask, Args... args) const
+    {
+        return dispatch(true, mask, args...);
+    }
+
+    template <typename... Args>
+    size_t signal<Args...>::emit_combining(Args... args) const
+    {
+        if (frozen.load(std::memory_order_acquire) != nullptr)
+        {
+            return dispatch(false, all_categories, args...);
+        }
+
+        if (mutex.try_lock())
+        {
+            auto count = size_t{0};
+            std::shared_ptr<const std::vector<forward_target>> targets;
+            {
+                std::unique_lock<std::mutex> ul(mutex, std::adopt_lock);
+                if (closed)
+                {
+                    return 0;
+                }
+                count = call(observers, masks, false, all_categories, args...);
+                if (dead_count.load(std::memory_order_relaxed) != 0 && frozen.load(std::memory_order_relaxed) == nullptr)
+                {
+                    reap();
+                }
+                targets = forwards;
+                combine();
+            }
+            return count + call_forwards(targets.get(), false, all_categories, args...);
+        }
+
+        // waits without the lock, the destructor waits for it to return
+        detail::count_guard waiter(waiting);
+        auto request = combine_request{std::tie(args...), current_trace()};
+        request.next = pending.load(std::memory_order_relaxed);
+        while (!pending.compare_exchange_weak(request.next, &request, std::memory_order_release, std::memory_order_relaxed)) {}
+
+        // the lock holder may have finished before the request was
+        // published, in that case this thread combines
+        while (!request.done.load(std::memory_order_acquire))
+        {
+            if (mutex.try_lock())
+            {
+                std::unique_lock<std::mutex> ul(mutex, std::adopt_lock);
+                combine();
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        if (request.error)
+        {
+            std::rethrow_exception(request.error);
+        }
+        return request.count + call_forwards(request.targets.get(), false, all_categories, args...);
+    }
+
+    template <typename... Args>
+    void signal<Args...>::combine() const
+    {
+        while (auto list = pending.exchange(nullptr, std::memory_order_acquire))
+        {
+            // the stack is newest first, call in the order of publication
+            combine_request* ordered = nullptr;
+            while (list != nullptr)
+            {
+                auto next  = list->next;
+                list->next = ordered;
+                ordered    = list;
+                list       = next;
+            }
+
+            while (ordered != nullptr)
+            {
+                auto request = ordered;
+                ordered = request->next;
+                try
+                {
+                    // emissions queued after the destructor started are dropped
+                    if (!closed)
+                    {
+                        trace_scope scope(request->trace);
+                        request->count = std::apply([this] (auto&... a) {
+                            return call(observers, masks, false, all_categories, a...);
+                        }, request->args);
+                    }
+                }
+                catch (...)
+                {
+                    request->error = std::current_exception();
+                }
+                if (dead_count.load(std::memory_order_relaxed) != 0 && frozen.load(std::memory_order_relaxed) == nullptr)
+                {
+                    reap();
+                }
+                if (!closed)
+                {
+                    request->targets = forwards;
+                }
+                request->done.store(true, std::memory_order_release);
+            }
+        }
+    }
+
+    template <typename... Args>
+    void signal<Args...>::freeze()
+    {
+        {
+            std::scoped_lock<std::mutex> sl(mutex);
+            if (frozen.load(std::memory_order_relaxed) != nullptr)
+            {
+                return;
+            }
+            if (dead_count.load(std::memory_order_relaxed) != 0)
+            {
+                reap();
+            }
+
+            frozen_owner = std::make_unique<frozen_table>(frozen_table{observers, masks, forwards});
+            frozen.store(frozen_owner.get(), std::memory_order_release);
+            stats.freezes++;
+        }
+        // free the tables of earlier freezes
+        drain();
+    }
+
+    template <typename... Args>
+    bool signal<Args...>::is_frozen() const noexcept
+    {
+        return frozen.load(std::memory_order_acquire) != nullptr;
+    }
+
+    template <typename... Args>
+    signal_stats signal<Args...>::get_stats() const
+    {
+        std::scoped_lock<std::mutex> sl(mutex);
+        return stats;
+    }
+
+    template <typename... Args>
+    size_t signal<Args...>::dispatch(bool masked, std::uint64_t mask, Args&... args) const
+    {
+        // only emits of a frozen signal are marked, the others hold the lock
+        if (frozen.load(std::memory_order_relaxed) != nullptr)
+        {
+            detail::read_guard reader(this);
+            if (auto table = frozen.load(std::memory_order_seq_cst))
+            {
+                auto count = call(table->observers, table->masks, masked, mask, args...);
+                return count + call_forwards(table->forwards.get(), masked, mask, args...);
+            }
+        }
+
+        auto count = size_t{0};
+        std::shared_ptr<const std::vector<forward_target>> targets;
+        {
+            detail::counted_lock sl(mutex, waiting);
+            if (closed)
+            {
+                return 0;
+            }
+            count = call(observers, masks, masked, mask, args...);
+            // a frozen table is index aligned to observers, keep it that way
+            if (dead_count.load(std::memory_order_relaxed) != 0 && frozen.load(std::memory_order_relaxed) == nullptr)
+            {
+                reap();
+            }
+            targets = forwards;
+        }
+        return count + call_forwards(targets.get(), masked, mask, args...);
+    }
+
+    template <typename... Args>
+    size_t signal<Args...>::call(std::vector<observer>& obs, const std::vector<std::uint64_t>& m, bool masked, std::uint64_t mask, Args&... args) const
+    {
+        auto count = size_t{0};
+        if (masked)
+        {
+            detail::scan_masks(m.data(), m.size(), mask, [&] (size_t i) {
+                if (invoke(obs[i], args...))
+                {
+                    count++;
+                }
+            });
+        }
+        else
+        {
+            for (auto& o : obs)
+            {
+                if (invoke(o, args...))
+                {
+                    count++;
+                }
+            }
+        }
+        return count;
+    }
+
+    template <typename... Args>
+    size_t signal<Args...>::call_forwards(const std::vector<forward_target>* targets, bool masked, std::uint64_t mask, Args&... args)
+    {
+        auto count = size_t{0};
+        if (targets != nullptr)
+        {
+            for (auto& f : *targets)
+            {
+                if (!masked || (f.mask & mask) != 0)
+                {
+                    count += f.target->dispatch(masked, mask, args...);
+                }
+            }
+        }
+        return count;
+    }
+
+    template <typename... Args>
+    void signal<Args...>::thaw()
+    {
+        auto table = frozen.exchange(nullptr, std::memory_order_seq_cst);
+        if (table == nullptr)
+        {
+            return;
+        }
+
+        // the table has the current dead flags; a once observer that was
+        // not called yet is claimed here, so emits that still run on the
+        // table can not call it after the thaw
+        for (auto i = size_t{0}; i < observers.size(); i++)
+        {
+            auto& t = table->observers[i];
+            observers[i].dead.set(t.once ? t.dead.exchange(true) : t.dead.get());
+        }
+        retired.push_back(std::move(frozen_owner));
+        stats.thaws++;
+        if (dead_count.load(std::memory_order_relaxed) != 0)
+        {
+            reap();
+        }
+    }
+
+    template <typename... Args>
+    void signal<Args...>::drain()
+    {
+        // an observer of a frozen emit would wait for itself
+        if (detail::is_reading(this))
+        {
+            return;
+        }
+
+        std::vector<std::unique_ptr<frozen_table>> done;
+        {
+            std::scoped_lock<std::mutex> sl(mutex);
+            done.swap(retired);
+        }
+        if (!done.empty())
+        {
+            detail::wait_readers(this);
+        }
+    }
+
+    template <typename... Args>
+    connection signal<Args...>::add(observer o, std::uint64_t mask)
     {
         std::scoped_lock<std::mutex> sl(mutex);
-        for (auto& [id, fun] : observers)
+        if (!o.fun && o.raw == nullptr)
+        {
+            throw std::invalid_argument("Signal observer is invalid.");
+        }
+        thaw();
+
+        o.id    = ++last_id;
+        o.plain = is_plain(o);
+        observers.push_back(std::move(o));
+        masks.push_back(mask);
+        return {last_id, this};
+    }
+
+    template <typename... Args>
+    typename std::vector<typename signal<Args...>::observer>::iterator signal<Args...>::find(connection id, const char* what)
+    {
+        if (id.signal != this)
         {
-            assert(fun);
-            fun(args...);
+            throw std::invalid_argument(what);
         }
-        return observers.size();
+
+        auto i = std::lower_bound(begin(observers), end(observers), id.id, [] (const observer& o, size_t id) {
+            return o.id < id;
+        });
+        if (i == end(observers) || i->id != id.id)
+        {
+            throw std::runtime_error("No observer with this id.");
+        }
+        return i;
+    }
+
+    template <typename... Args>
+    bool signal<Args...>::invoke(observer& o, Args&... args) const
+    {
+        // kept small, so that it is inlined into the loop of call
+        if (o.dead.get())
+        {
+            return false;
+        }
+        if (o.plain)
+        {
+            if (o.blocked.get())
+            {
+                return false;
+            }
+            o.fun(args...);
+            return true;
+        }
+        return invoke_special(o, args...);
+    }
+
+    template <typename... Args>
+    bool signal<Args...>::invoke_special(observer& o, Args&... args) const
+    {
+#ifdef RSIG_STOP_TOKEN
+        if (o.token.stop_requested())
+        {
+            mark_dead(o);
+            return false;
+        }
+#endif
+
+        if (o.blocked.get() || (o.grp != nullptr && o.grp->is_blocked()))
+        {
+            return false;
+        }
+
+        if (o.once)
+        {
+            // concurrent emits of a frozen signal race for the one call
+            if (o.dead.exchange(true))
+            {
+                return false;
+            }
+            dead_count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (o.raw != nullptr)
+        {
+            o.raw(o.context, args...);
+            return true;
+        }
+
+        if (o.tracked)
+        {
+            // the reference keeps the object alive during the call
+            auto life = o.life.lock();
+            if (!life)
+            {
+                mark_dead(o);
+                return false;
+            }
+            assert(o.fun);
+            o.fun(args...);
+            return true;
+        }
+
+        assert(o.fun);
+        o.fun(args...);
+        return true;
+    }
+
+    template <typename... Args>
+    bool signal<Args...>::is_plain(const observer& o) noexcept
+    {
+#ifdef RSIG_STOP_TOKEN
+        if (o.token.stop_possible())
+        {
+            return false;
+        }
+#endif
+        return o.raw == nullptr && o.grp == nullptr && !o.once && !o.tracked;
+    }
+
+    template <typename... Args>
+    void signal<Args...>::reap() const
+    {
+        auto j = size_t{0};
+        for (auto i = size_t{0}; i < observers.size(); i++)
+        {
+            if (observers[i].dead.get())
+            {
+                continue;
+            }
+            if (i != j)
+            {
+                observers[j] = std::move(observers[i]);
+                masks[j]     = masks[i];
+            }
+            j++;
+        }
+        observers.erase(begin(observers) + j, end(observers));
+        masks.erase(begin(masks) + j, end(masks));
+        dead_count.store(0, std::memory_order_relaxed);
+    }
+
+    template <typename... Args>
+    void signal<Args...>::mark_dead(observer& o) const
+    {
+        o.dead.set(true);
+        dead_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /*!
+     * Forward the events of one signal to another.
+     *
+     * @param from the signal whose events are forwarded
+     * @param to the signal to emit
+     * @param mask the categories to forward
+     * @return the connection for this forward, disconnect it on from
+     *
+     * @see signal::forward
+     */
+    template <typename... Args>
+    connection forward(signal<Args...>& from, const signal<Args...>& to, std::uint64_t mask = all_categories)
+    {
+        return from.forward(to, mask);
     }
 
     template<typename Class, class Ret, class... Args>
@@ -0,0 +1,116 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "rsig_c.h"
+
+#include <new>
+
+#include "rsig.h"
+
+// The C observers live in the same observer storage as C++ observers and
+// are called through their function pointer, without std::function.
+struct rsig_signal
+{
+    rsig::signal<const void*> sig;
+};
+
+extern "C"
+{
+    rsig_signal* rsig_signal_create(void)
+    {
+        return new (std::nothrow) rsig_signal;
+    }
+
+    void rsig_signal_destroy(rsig_signal* sig)
+    {
+        delete sig;
+    }
+
+    rsig_result rsig_signal_connect(rsig_signal* sig, rsig_observer fun, void* context, rsig_connection* con)
+    {
+        if (sig == nullptr || fun == nullptr || con == nullptr)
+        {
+            return RSIG_INVALID_ARGUMENT;
+        }
+
+        try
+        {
+            auto c = sig->sig.connect(fun, context);
+            con->id     = c.id;
+            con->signal = c.signal;
+            return RSIG_OK;
+        }
+        catch (...)
+        {
+            return RSIG_ERROR;
+        }
+    }
+
+    rsig_result rsig_signal_disconnect(rsig_signal* sig, rsig_connection con)
+    {
+        if (sig == nullptr)
+        {
+            return RSIG_INVALID_ARGUMENT;
+        }
+
+        try
+        {
+            sig->sig.disconnect({con.id, con.signal});
+            return RSIG_OK;
+        }
+        catch (const std::invalid_argument&)
+        {
+            return RSIG_INVALID_ARGUMENT;
+        }
+        catch (const std::runtime_error&)
+        {
+            return RSIG_NOT_FOUND;
+        }
+        catch (...)
+        {
+            return RSIG_ERROR;
+        }
+    }
+
+    rsig_result rsig_signal_emit(rsig_signal* sig, const void* event, size_t* count)
+    {
+        if (sig == nullptr)
+        {
+            return RSIG_INVALID_ARGUMENT;
+        }
+
+        try
+        {
+            auto n = sig->sig.emit(event);
+            if (count != nullptr)
+            {
+                *count = n;
+            }
+            return RSIG_OK;
+        }
+        catch (...)
+        {
+            return RSIG_ERROR;
+        }
+    }
+}
@@ -0,0 +1,94 @@
+/*
+ * rsig - rioki's signal library
+ * Copyright (c) 2020 Sean Farrell
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _RSIG_C_H_
+#define _RSIG_C_H_
+
+/*
+ * Stable C interface to rsig signals.
+ *
+ * The C interface can be used across shared library boundaries, where the
+ * modules are built with different compilers or standard libraries. The
+ * events are passed as a pointer to a caller defined payload.
+ */
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#  if defined(RSIG_C_BUILD)
+#    define RSIG_C_API __declspec(dllexport)
+#  elif defined(RSIG_C_SHARED)
+#    define RSIG_C_API __declspec(dllimport)
+#  else
+#    define RSIG_C_API
+#  endif
+#else
+#  define RSIG_C_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Opaque handle to a signal. */
+typedef struct rsig_signal rsig_signal;
+
+/* Handle to a signal / observer connection, to be considered opaque. */
+typedef struct rsig_connection
+{
+    size_t id;
+    void*  signal;
+} rsig_connection;
+
+/* Observer function, called with the connect context and the emitted event. */
+typedef void (*rsig_observer)(void* context, const void* event);
+
+/* Result codes. */
+typedef enum rsig_result
+{
+    RSIG_OK               = 0,
+    RSIG_INVALID_ARGUMENT = 1,
+    RSIG_NOT_FOUND        = 2,
+    RSIG_ERROR            = 3
+} rsig_result;
+
+/* Create a signal, returns NULL when out of memory. */
+RSIG_C_API rsig_signal* rsig_signal_create(void);
+
+/* Destroy a signal created with rsig_signal_create. */
+RSIG_C_API void rsig_signal_destroy(rsig_signal* sig);
+
+/* Connect an observer, the connection is written to con. */
+RSIG_C_API rsig_result rsig_signal_connect(rsig_signal* sig, rsig_observer fun, void* context, rsig_connection* con);
+
+/* Disconnect an observer. */
+RSIG_C_API rsig_result rsig_signal_disconnect(rsig_signal* sig, rsig_connection con);
+
+/* Emit an event, the number of called observers is written to count, if not NULL. */
+RSIG_C_API rsig_result rsig_signal_emit(rsig_signal* sig, const void* event, size_t* count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
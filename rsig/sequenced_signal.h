@@ -0,0 +1,248 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef _RSIG_SEQUENCED_SIGNAL_H_
+#define _RSIG_SEQUENCED_SIGNAL_H_
+
+#include <map>
+#include <tuple>
+#include <type_traits>
+
+#include "rsig.h"
+
+namespace rsig
+{
+    /*!
+     * A signal that is dispatched in a deterministic order.
+     *
+     * Events are emitted through producers with a fixed id, each event is
+     * stamped with the current tick, the producer id and the sequence
+     * number of the producer. advance starts the next tick and calls the
+     * observers for the events of the ticks before, in (tick, producer,
+     * sequence) order, so the order does not depend on thread scheduling.
+     * Events stamped with the new tick wait for the next advance. The
+     * trace context of the emit is restored around the observer calls.
+     *
+     * @note For a reproducible order the producers must finish emitting
+     * for a tick before advance is called, like in a lockstep simulation.
+     */
+    template <typename... Args>
+    class sequenced_signal
+    {
+    public:
+        //! The emitting side of one thread or simulation entity.
+        class producer
+        {
+        public:
+            /*!
+             * Queue a signal event for the current tick.
+             *
+             * @param args the values of this signal event
+             */
+            void emit(Args... args);
+
+            //! The id of this producer.
+            std::uint32_t get_id() const noexcept;
+
+        private:
+            struct event
+            {
+                std::uint64_t                       tick;
+                std::uint64_t                       seq;
+                trace_context                       trace;
+                std::tuple<std::decay_t<Args>...>   args;
+            };
+
+            sequenced_signal<Args...>*  owner = nullptr;
+            std::uint32_t               id  = 0;
+            std::uint64_t               seq = 0;
+            std::mutex                  mutex;
+            std::vector<event>          pending;
+
+            friend class sequenced_signal<Args...>;
+        };
+
+        sequenced_signal() = default;
+        ~sequenced_signal() = default;
+
+        /*!
+         * Connect an observer to the signal.
+         *
+         * @param fun the lambda function that will be called by advance.
+         * @return the connection for this observer
+         */
+        connection connect(const std::function<void(Args...)>& fun);
+
+        /*!
+         * Disconnect an observer.
+         *
+         * @param id the connection returned by connect
+         */
+        void disconnect(connection id);
+
+        /*!
+         * Get a producer.
+         *
+         * @param id the id of the producer, it orders events of the same tick
+         * @return the producer, owned by the signal
+         */
+        producer& get_producer(std::uint32_t id);
+
+        /*!
+         * Dispatch the queued events and start the next tick.
+         *
+         * @return the number of dispatched events
+         */
+        size_t advance();
+
+        //! The tick new events are stamped with.
+        std::uint64_t current_tick() const noexcept;
+
+    private:
+        struct stamped
+        {
+            std::uint64_t                               tick;
+            std::uint32_t                               producer;
+            std::uint64_t                               seq;
+            size_t                                      index;
+        };
+
+        std::atomic<std::uint64_t>  tick = 0;
+        std::mutex                  mutex;
+        std::mutex                  advance_mutex;
+        // ordered by id, so events of a tick are collected in order
+        std::map<std::uint32_t, std::unique_ptr<producer>> producers;
+        // only touched under advance_mutex, keep their capacity between ticks
+        std::vector<typename producer::event>   events;
+        std::vector<stamped>                    order;
+        signal<Args...>                         observers;
+
+        sequenced_signal(const sequenced_signal<Args...>&) = delete;
+        sequenced_signal<Args...>& operator = (const sequenced_signal<Args...>&) = delete;
+    };
+
+    template <typename... Args>
+    void sequenced_signal<Args...>::producer::emit(Args... args)
+    {
+        auto t = owner->tick.load(std::memory_order_acquire);
+        std::scoped_lock<std::mutex> sl(mutex);
+        pending.push_back({t, seq++, current_trace(), {args...}});
+    }
+
+    template <typename... Args>
+    std::uint32_t sequenced_signal<Args...>::producer::get_id() const noexcept
+    {
+        return id;
+    }
+
+    template <typename... Args>
+    connection sequenced_signal<Args...>::connect(const std::function<void(Args...)>& fun)
+    {
+        return observers.connect(fun);
+    }
+
+    template <typename... Args>
+    void sequenced_signal<Args...>::disconnect(connection id)
+    {
+        observers.disconnect(id);
+    }
+
+    template <typename... Args>
+    typename sequenced_signal<Args...>::producer& sequenced_signal<Args...>::get_producer(std::uint32_t id)
+    {
+        std::scoped_lock<std::mutex> sl(mutex);
+        auto& p = producers[id];
+        if (!p)
+        {
+            p.reset(new producer);
+            p->owner = this;
+            p->id    = id;
+        }
+        return *p;
+    }
+
+    template <typename... Args>
+    size_t sequenced_signal<Args...>::advance()
+    {
+        std::scoped_lock<std::mutex> al(advance_mutex);
+        auto boundary = tick.fetch_add(1, std::memory_order_acq_rel);
+
+        events.clear();
+        order.clear();
+        {
+            std::scoped_lock<std::mutex> sl(mutex);
+            for (auto& [id, p] : producers)
+            {
+                // events emitted while collecting carry the new tick, they
+                // stay queued so that the grouping does not depend on timing
+                std::scoped_lock<std::mutex> pl(p->mutex);
+                auto keep = begin(p->pending);
+                for (auto i = begin(p->pending); i != end(p->pending); ++i)
+                {
+                    if (i->tick <= boundary)
+                    {
+                        order.push_back({i->tick, id, i->seq, events.size()});
+                        events.push_back(std::move(*i));
+                    }
+                    else
+                    {
+                        if (keep != i)
+                        {
+                            *keep = std::move(*i);
+                        }
+                        ++keep;
+                    }
+                }
+                p->pending.erase(keep, end(p->pending));
+            }
+        }
+
+        // collected by producer and sequence, only events that were stamped
+        // just before the previous advance collected carry an older tick
+        auto less = [] (const stamped& a, const stamped& b) {
+            return std::tie(a.tick, a.producer, a.seq) < std::tie(b.tick, b.producer, b.seq);
+        };
+        if (!std::is_sorted(begin(order), end(order), less))
+        {
+            std::sort(begin(order), end(order), less);
+        }
+
+        for (auto& o : order)
+        {
+            auto& e = events[o.index];
+            trace_scope scope(e.trace);
+            std::apply([this] (auto&... args) {
+                observers.emit(args...);
+            }, e.args);
+        }
+        return order.size();
+    }
+
+    template <typename... Args>
+    std::uint64_t sequenced_signal<Args...>::current_tick() const noexcept
+    {
+        return tick.load(std::memory_order_acquire);
+    }
+}
+
+#endif
@@ -0,0 +1,346 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef _RSIG_SLAB_H_
+#define _RSIG_SLAB_H_
+
+#include <memory>
+#include <utility>
+
+#include "rsig.h"
+
+namespace rsig
+{
+    template <typename T>
+    class slab_pool;
+
+    namespace detail
+    {
+        template <typename T>
+        struct slab_slot
+        {
+            T                       value;
+            std::atomic<size_t>     refs = 0;
+            slab_pool<T>*           pool = nullptr;
+            slab_slot*              next = nullptr;
+        };
+    }
+
+    /*!
+     * Read only reference to a payload in a slab_pool.
+     *
+     * The payload goes back to its pool when the last reference is
+     * released. Emit slabs on a signal<const slab_ptr<T>&>, observers that
+     * only read the payload do not touch the reference count; observers
+     * that need it later keep a copy.
+     */
+    template <typename T>
+    class slab_ptr
+    {
+    public:
+        slab_ptr() noexcept = default;
+        slab_ptr(const slab_ptr<T>& other) noexcept;
+        slab_ptr(slab_ptr<T>&& other) noexcept;
+        ~slab_ptr();
+
+        slab_ptr<T>& operator = (const slab_ptr<T>& other) noexcept;
+        slab_ptr<T>& operator = (slab_ptr<T>&& other) noexcept;
+
+        //! The payload, or nullptr for an empty reference.
+        const T* get() const noexcept;
+
+        const T& operator * () const noexcept;
+        const T* operator -> () const noexcept;
+
+        //! Check if the reference refers to a payload.
+        explicit operator bool () const noexcept;
+
+        //! Drop the reference.
+        void reset() noexcept;
+
+    private:
+        detail::slab_slot<T>* slot = nullptr;
+
+        explicit slab_ptr(detail::slab_slot<T>* s) noexcept;
+
+        friend class slab_pool<T>;
+    };
+
+    /*!
+     * Pool of recycled payloads.
+     *
+     * The pool keeps its payloads constructed. Filling a payload assigns to
+     * an object that was used before, so containers inside it keep their
+     * capacity and a steady stream of events allocates nothing.
+     *
+     * @note The pool is thread safe. It must outlive all slabs taken from it.
+     */
+    template <typename T>
+    class slab_pool
+    {
+    public:
+        /*!
+         * Create a pool.
+         *
+         * @param count the number of payloads to create up front
+         */
+        explicit slab_pool(size_t count = 0);
+        ~slab_pool();
+
+        /*!
+         * Take a payload and copy a value into it.
+         *
+         * @param value the value to copy
+         * @return the reference to the payload
+         */
+        slab_ptr<T> make(const T& value);
+
+        /*!
+         * Take a payload and fill it in place.
+         *
+         * @param fill called with the payload to write, it still holds the
+         * value of its last use
+         * @return the reference to the payload
+         */
+        template <typename Fill>
+        slab_ptr<T> make_with(Fill fill);
+
+        //! The number of payloads owned by the pool.
+        size_t capacity() const;
+
+        //! The number of payloads that are not in use.
+        size_t available() const;
+
+    private:
+        mutable std::mutex                                  mutex;
+        std::vector<std::unique_ptr<detail::slab_slot<T>[]>> chunks;
+        detail::slab_slot<T>*                               free_list = nullptr;
+        size_t                                              total = 0;
+        size_t                                              idle  = 0;
+
+        detail::slab_slot<T>* take();
+        void grow(size_t count);
+        void give_back(detail::slab_slot<T>* slot) noexcept;
+
+        slab_pool(const slab_pool<T>&) = delete;
+        slab_pool<T>& operator = (const slab_pool<T>&) = delete;
+
+        friend class slab_ptr<T>;
+    };
+
+    /*!
+     * Emit a payload from a pool.
+     *
+     * @param sig the signal to emit
+     * @param pool the pool to take the payload from
+     * @param fill called with the payload to write
+     * @return the number of called functions
+     */
+    template <typename T, typename Fill>
+    size_t emit_slab(const signal<const slab_ptr<T>&>& sig, slab_pool<T>& pool, Fill fill)
+    {
+        return sig.emit(pool.make_with(std::move(fill)));
+    }
+
+    template <typename T>
+    slab_ptr<T>::slab_ptr(detail::slab_slot<T>* s) noexcept
+    : slot(s) {}
+
+    template <typename T>
+    slab_ptr<T>::slab_ptr(const slab_ptr<T>& other) noexcept
+    : slot(other.slot)
+    {
+        if (slot != nullptr)
+        {
+            slot->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    template <typename T>
+    slab_ptr<T>::slab_ptr(slab_ptr<T>&& other) noexcept
+    : slot(std::exchange(other.slot, nullptr)) {}
+
+    template <typename T>
+    slab_ptr<T>::~slab_ptr()
+    {
+        reset();
+    }
+
+    template <typename T>
+    slab_ptr<T>& slab_ptr<T>::operator = (const slab_ptr<T>& other) noexcept
+    {
+        if (slot != other.slot)
+        {
+            if (other.slot != nullptr)
+            {
+                other.slot->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+            reset();
+            slot = other.slot;
+        }
+        return *this;
+    }
+
+    template <typename T>
+    slab_ptr<T>& slab_ptr<T>::operator = (slab_ptr<T>&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            slot = std::exchange(other.slot, nullptr);
+        }
+        return *this;
+    }
+
+    template <typename T>
+    const T* slab_ptr<T>::get() const noexcept
+    {
+        return slot != nullptr ? &slot->value : nullptr;
+    }
+
+    template <typename T>
+    const T& slab_ptr<T>::operator * () const noexcept
+    {
+        assert(slot != nullptr);
+        return slot->value;
+    }
+
+    template <typename T>
+    const T* slab_ptr<T>::operator -> () const noexcept
+    {
+        assert(slot != nullptr);
+        return &slot->value;
+    }
+
+    template <typename T>
+    slab_ptr<T>::operator bool () const noexcept
+    {
+        return slot != nullptr;
+    }
+
+    template <typename T>
+    void slab_ptr<T>::reset() noexcept
+    {
+        auto s = std::exchange(slot, nullptr);
+        if (s != nullptr && s->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            s->pool->give_back(s);
+        }
+    }
+
+    template <typename T>
+    slab_pool<T>::slab_pool(size_t count)
+    {
+        if (count != 0)
+        {
+            grow(count);
+        }
+    }
+
+    template <typename T>
+    slab_pool<T>::~slab_pool()
+    {
+        assert(idle == total && "slab_pool destroyed while slabs are in use");
+    }
+
+    template <typename T>
+    slab_ptr<T> slab_pool<T>::make(const T& value)
+    {
+        return make_with([&value] (T& payload) {
+            payload = value;
+        });
+    }
+
+    template <typename T>
+    template <typename Fill>
+    slab_ptr<T> slab_pool<T>::make_with(Fill fill)
+    {
+        auto slot = take();
+        try
+        {
+            fill(slot->value);
+        }
+        catch (...)
+        {
+            give_back(slot);
+            throw;
+        }
+        slot->refs.store(1, std::memory_order_relaxed);
+        return slab_ptr<T>(slot);
+    }
+
+    template <typename T>
+    size_t slab_pool<T>::capacity() const
+    {
+        std::scoped_lock<std::mutex> sl(mutex);
+        return total;
+    }
+
+    template <typename T>
+    size_t slab_pool<T>::available() const
+    {
+        std::scoped_lock<std::mutex> sl(mutex);
+        return idle;
+    }
+
+    template <typename T>
+    detail::slab_slot<T>* slab_pool<T>::take()
+    {
+        std::scoped_lock<std::mutex> sl(mutex);
+        if (free_list == nullptr)
+        {
+            // double the pool, so that the number of chunks stays small
+            grow(std::max<size_t>(total, 16));
+        }
+        auto slot = free_list;
+        free_list = slot->next;
+        idle--;
+        return slot;
+    }
+
+    template <typename T>
+    void slab_pool<T>::grow(size_t count)
+    {
+        auto chunk = std::make_unique<detail::slab_slot<T>[]>(count);
+        for (auto i = size_t{0}; i < count; i++)
+        {
+            chunk[i].pool = this;
+            chunk[i].next = free_list;
+            free_list = &chunk[i];
+        }
+        chunks.push_back(std::move(chunk));
+        total += count;
+        idle  += count;
+    }
+
+    template <typename T>
+    void slab_pool<T>::give_back(detail::slab_slot<T>* slot) noexcept
+    {
+        std::scoped_lock<std::mutex> sl(mutex);
+        slot->next = free_list;
+        free_list = slot;
+        idle++;
+    }
+}
+
+#endif
@@ -0,0 +1,323 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef _RSIG_SOCKET_BRIDGE_H_
+#define _RSIG_SOCKET_BRIDGE_H_
+
+#ifndef __linux__
+#error "rsig/socket_bridge.h requires Linux."
+#endif
+
+#include <cerrno>
+#include <system_error>
+#include <utility>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "rsig.h"
+#include "codec.h"
+
+namespace rsig
+{
+    /*!
+     * Forward the emissions of a signal over a socket.
+     *
+     * Every emission is encoded as one frame, the length of the frame as
+     * varint followed by the arguments encoded with codec. Frames are
+     * collected in a buffer and written in one batch, once the buffer
+     * reaches the batch size or when flush is called.
+     *
+     * A failed write is not thrown from the emitting thread, it is kept and
+     * thrown by the next flush. Frames of later emissions are dropped.
+     *
+     * @note The batch is written by the emitting thread, with a blocking
+     * send while the lock of the source signal is held. A slow peer stalls
+     * the emit and every other emit of the source until the send returns.
+     *
+     * @note Frames are not sent on a timer. Frames below the batch size stay
+     * in the buffer until a later emit fills it or flush is called, so call
+     * flush when the source goes quiet.
+     *
+     * @note The sender does not own the socket, it must outlive the sender.
+     */
+    template <typename... Args>
+    class socket_sender
+    {
+    public:
+        /*!
+         * Start forwarding a signal.
+         *
+         * @param source the signal to forward
+         * @param fd a connected stream socket, for example a Unix domain socket
+         * @param batch_size the number of buffered bytes that triggers a write
+         */
+        socket_sender(signal<Args...>& source, int fd, size_t batch_size = 16384u);
+
+        //! Stop forwarding and write the pending frames.
+        ~socket_sender();
+
+        /*!
+         * Write all pending frames.
+         *
+         * @throws std::system_error if this or an earlier write failed
+         */
+        void flush();
+
+    private:
+        signal<Args...>& source;
+        int              fd;
+        size_t           batch_size;
+        connection       con;
+
+        std::mutex       mutex;
+        byte_buffer      frames;
+        byte_buffer      scratch;
+        // errno of the first failed write
+        int              error = 0;
+
+        void append(const Args&... args);
+        void write_frames();
+
+        socket_sender(const socket_sender<Args...>&) = delete;
+        socket_sender<Args...>& operator = (const socket_sender<Args...>&) = delete;
+    };
+
+    /*!
+     * Receive emissions forwarded by a socket_sender.
+     *
+     * The received frames are decoded and emitted on a mirror signal in
+     * this process.
+     *
+     * @note The receiver does not own the socket, it must outlive the receiver.
+     */
+    template <typename... Args>
+    class socket_receiver
+    {
+    public:
+        /*!
+         * Start receiving.
+         *
+         * @param fd a connected stream socket
+         * @param mirror the signal to emit the received events on
+         */
+        socket_receiver(int fd, signal<Args...>& mirror);
+        ~socket_receiver() = default;
+
+        /*!
+         * Read once from the socket and emit all complete frames.
+         *
+         * On a blocking socket this blocks until data is available. If
+         * decoding or an observer throws, the frames emitted so far are
+         * consumed and the rest are emitted by the next call.
+         *
+         * @return the number of emitted events
+         */
+        size_t receive();
+
+        //! Check if the sender closed the connection.
+        bool is_closed() const noexcept;
+
+    private:
+        int              fd;
+        signal<Args...>& mirror;
+        bool             closed   = false;
+        bool             leftover = false;
+        byte_buffer      buffer;
+
+        size_t emit_frames(size_t& consumed);
+
+        socket_receiver(const socket_receiver<Args...>&) = delete;
+        socket_receiver<Args...>& operator = (const socket_receiver<Args...>&) = delete;
+    };
+
+    template <typename... Args>
+    socket_sender<Args...>::socket_sender(signal<Args...>& s, int f, size_t bs)
+    : source(s), fd(f), batch_size(bs)
+    {
+        frames.reserve(batch_size + 256u);
+        con = source.connect([this] (Args... args) {
+            append(args...);
+        });
+    }
+
+    template <typename... Args>
+    socket_sender<Args...>::~socket_sender()
+    {
+        source.disconnect(con);
+        try
+        {
+            flush();
+        }
+        catch (...)
+        {
+            // the peer is gone, nothing left to deliver to
+        }
+    }
+
+    template <typename... Args>
+    void socket_sender<Args...>::flush()
+    {
+        std::scoped_lock<std::mutex> sl(mutex);
+        write_frames();
+        if (error != 0)
+        {
+            throw std::system_error(error, std::generic_category(), "socket_sender: send failed");
+        }
+    }
+
+    template <typename... Args>
+    void socket_sender<Args...>::append(const Args&... args)
+    {
+        std::scoped_lock<std::mutex> sl(mutex);
+        if (error != 0)
+        {
+            return;
+        }
+        scratch.clear();
+        encode_args(scratch, args...);
+        encode_varint(frames, scratch.size());
+        frames.insert(end(frames), begin(scratch), end(scratch));
+        if (frames.size() >= batch_size)
+        {
+            write_frames();
+        }
+    }
+
+    template <typename... Args>
+    void socket_sender<Args...>::write_frames()
+    {
+        // runs on the emitting thread, so failures are kept for flush
+        auto offset = size_t{0};
+        while (offset < frames.size() && error == 0)
+        {
+            auto r = ::send(fd, frames.data() + offset, frames.size() - offset, MSG_NOSIGNAL);
+            if (r < 0)
+            {
+                if (errno != EINTR)
+                {
+                    error = errno;
+                }
+                continue;
+            }
+            offset += static_cast<size_t>(r);
+        }
+        frames.clear();
+    }
+
+    template <typename... Args>
+    socket_receiver<Args...>::socket_receiver(int f, signal<Args...>& m)
+    : fd(f), mirror(m) {}
+
+    template <typename... Args>
+    size_t socket_receiver<Args...>::receive()
+    {
+        constexpr auto chunk = size_t{65536};
+
+        // complete frames left over from a throw are emitted without
+        // reading, so a blocking socket does not wait for new data first
+        if (!leftover)
+        {
+            auto old_size = buffer.size();
+            buffer.resize(old_size + chunk);
+            auto r = ::recv(fd, buffer.data() + old_size, chunk, 0);
+            if (r <= 0)
+            {
+                auto error = errno;
+                buffer.resize(old_size);
+                if (r == 0)
+                {
+                    closed = true;
+                    return 0;
+                }
+                if (error == EINTR || error == EAGAIN || error == EWOULDBLOCK)
+                {
+                    return 0;
+                }
+                throw std::system_error(error, std::generic_category(), "socket_receiver: recv failed");
+            }
+            buffer.resize(old_size + static_cast<size_t>(r));
+        }
+        leftover = false;
+
+        auto count    = size_t{0};
+        auto consumed = size_t{0};
+        try
+        {
+            count = emit_frames(consumed);
+        }
+        catch (...)
+        {
+            buffer.erase(begin(buffer), begin(buffer) + static_cast<std::ptrdiff_t>(consumed));
+            leftover = !buffer.empty();
+            throw;
+        }
+        buffer.erase(begin(buffer), begin(buffer) + static_cast<std::ptrdiff_t>(consumed));
+        return count;
+    }
+
+    template <typename... Args>
+    size_t socket_receiver<Args...>::emit_frames(size_t& consumed)
+    {
+        auto count = size_t{0};
+        while (consumed < buffer.size())
+        {
+            auto in = byte_reader(buffer.data() + consumed, buffer.size() - consumed);
+            auto size = std::uint64_t{0};
+            try
+            {
+                size = decode_varint(in);
+            }
+            catch (const std::runtime_error&)
+            {
+                if (buffer.size() - consumed >= 10u)
+                {
+                    throw;
+                }
+                // the length is split over two reads
+                break;
+            }
+            if (in.remaining() < size)
+            {
+                break;
+            }
+
+            auto frame = byte_reader(in.read(static_cast<size_t>(size)), static_cast<size_t>(size));
+            consumed = buffer.size() - in.remaining();
+
+            std::apply([this] (auto&&... args) {
+                mirror.emit(args...);
+            }, decode_args<Args...>(frame));
+            count++;
+        }
+        return count;
+    }
+
+    template <typename... Args>
+    bool socket_receiver<Args...>::is_closed() const noexcept
+    {
+        return closed;
+    }
+}
+
+#endif
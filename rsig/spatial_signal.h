@@ -0,0 +1,345 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef _RSIG_SPATIAL_SIGNAL_H_
+#define _RSIG_SPATIAL_SIGNAL_H_
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#include "rsig.h"
+
+namespace rsig
+{
+    //! A position in screen or world space.
+    struct point
+    {
+        float x = 0.0f;
+        float y = 0.0f;
+    };
+
+    //! An axis aligned region, the minimum is inclusive, the maximum exclusive.
+    struct box
+    {
+        point min;
+        point max;
+
+        bool contains(point p) const
+        {
+            return p.x >= min.x && p.x < max.x && p.y >= min.y && p.y < max.y;
+        }
+    };
+
+    namespace detail
+    {
+        inline void check_area(const box& area)
+        {
+            if (!std::isfinite(area.min.x) || !std::isfinite(area.min.y) ||
+                !std::isfinite(area.max.x) || !std::isfinite(area.max.y))
+            {
+                throw std::invalid_argument("spatial_signal: region is not finite");
+            }
+        }
+    }
+
+    /*!
+     * A thread safe signal multiplexer for region of interest observers.
+     *
+     * Each observer is connected with a region and is only called for
+     * events emitted at a position inside that region. The observers are
+     * indexed in a uniform grid, so emit only looks at the observers of the
+     * grid cell the position falls into.
+     *
+     * @note The cell size should be in the order of the typical observer
+     * region. Regions that cover more than max_cells cells are not put into
+     * the grid, but into a list that every emit checks.
+     */
+    template <typename... Args>
+    class spatial_signal
+    {
+    public:
+        //! The most cells a region is registered in.
+        static constexpr std::int64_t max_cells = 256;
+
+        /*!
+         * Create a spatial signal.
+         *
+         * @param cell_size the edge length of the grid cells
+         */
+        explicit spatial_signal(float cell_size = 64.0f);
+        ~spatial_signal() = default;
+
+        /*!
+         * Connect an observer to the signal.
+         *
+         * @param area the region the observer is interested in
+         * @param fun the lambda function that will be called when emit is called.
+         * @return the connection for this observer
+         *
+         * @throw std::invalid_argument if a coordinate of the region is not finite
+         *
+         * @warning If the context, like lambda captures, lifetime is shorter
+         * than the signal, the observer must be disconnected.
+         */
+        connection connect(const box& area, const std::function<void(Args...)>& fun);
+
+        /*!
+         * Change the region of an observer.
+         *
+         * @param id the connection returned by connect
+         * @param area the new region of the observer
+         *
+         * @throw std::invalid_argument if a coordinate of the region is not finite
+         */
+        void move(connection id, const box& area);
+
+        /*!
+         * Disconnect an observer.
+         *
+         * @param id the connection returned by connect
+         */
+        void disconnect(connection id);
+
+        /*!
+         * Emit a signal at a position.
+         *
+         * Calls all observers whose region contains the position and
+         * returns the number of called functions. A position that is not
+         * finite is in no region.
+         *
+         * @param position the position of this signal event
+         * @param args the values of this signal event
+         * @return the number of called functions
+         */
+        size_t emit(point position, Args... args) const;
+
+    private:
+        struct observer
+        {
+            size_t                          id;
+            box                             area;
+            std::function<void (Args...)>   fun;
+        };
+
+        mutable
+        std::mutex mutex;
+        float      cell_size;
+        size_t     last_id = 0;
+        std::unordered_map<size_t, observer> observers;
+        // per cell the observers ordered by id
+        std::unordered_map<std::uint64_t, std::vector<const observer*>> cells;
+        // the observers with regions over max_cells cells, ordered by id
+        std::vector<const observer*> wide;
+
+        struct span
+        {
+            std::int64_t x0, x1, y0, y1;
+
+            bool wide() const
+            {
+                return (x1 - x0 + 1) * (y1 - y0 + 1) > max_cells;
+            }
+        };
+
+        std::int32_t cell_coord(float v) const;
+        std::uint64_t cell_key(std::int32_t x, std::int32_t y) const;
+        span cells_of(const box& area) const;
+        void insert(const observer& o);
+        void remove(const observer& o);
+
+        spatial_signal(const spatial_signal<Args...>&) = delete;
+        spatial_signal<Args...>& operator = (const spatial_signal<Args...>&) = delete;
+    };
+
+    template <typename... Args>
+    spatial_signal<Args...>::spatial_signal(float cs)
+    : cell_size(cs)
+    {
+        if (!(cell_size > 0.0f))
+        {
+            throw std::invalid_argument("spatial_signal: cell size must be positive");
+        }
+    }
+
+    template <typename... Args>
+    connection spatial_signal<Args...>::connect(const box& area, const std::function<void(Args...)>& fun)
+    {
+        std::scoped_lock<std::mutex> sl(mutex);
+        if (!fun)
+        {
+            throw std::invalid_argument("Signal observer is invalid.");
+        }
+        detail::check_area(area);
+
+        auto id = ++last_id;
+        auto& o = observers[id] = {id, area, fun};
+        insert(o);
+        return {id, this};
+    }
+
+    template <typename... Args>
+    void spatial_signal<Args...>::move(connection id, const box& area)
+    {
+        if (id.signal != this)
+        {
+            throw std::invalid_argument("spatial_signal::move: mismatched connection");
+        }
+        detail::check_area(area);
+
+        std::scoped_lock<std::mutex> sl(mutex);
+        auto i = observers.find(id.id);
+        if (i == end(observers))
+        {
+            throw std::runtime_error("No observer with this id.");
+        }
+        remove(i->second);
+        i->second.area = area;
+        insert(i->second);
+    }
+
+    template <typename... Args>
+    void spatial_signal<Args...>::disconnect(connection id)
+    {
+        if (id.signal != this)
+        {
+            throw std::invalid_argument("spatial_signal::disconnect: mismatched connection");
+        }
+
+        std::scoped_lock<std::mutex> sl(mutex);
+        auto i = observers.find(id.id);
+        if (i == end(observers))
+        {
+            throw std::runtime_error("No observer with this id.");
+        }
+        remove(i->second);
+        observers.erase(i);
+    }
+
+    template <typename... Args>
+    size_t spatial_signal<Args...>::emit(point position, Args... args) const
+    {
+        if (!std::isfinite(position.x) || !std::isfinite(position.y))
+        {
+            return 0;
+        }
+
+        std::scoped_lock<std::mutex> sl(mutex);
+        auto i = cells.find(cell_key(cell_coord(position.x), cell_coord(position.y)));
+        if (i == end(cells) && wide.empty())
+        {
+            return 0;
+        }
+
+        // merge the cell with the wide regions, so the calls stay in id order
+        static const std::vector<const observer*> none;
+        const auto& cell = i != end(cells) ? i->second : none;
+        auto c = begin(cell);
+        auto w = begin(wide);
+        auto count = size_t{0};
+        while (c != end(cell) || w != end(wide))
+        {
+            auto o = w == end(wide) || (c != end(cell) && (*c)->id < (*w)->id) ? *c++ : *w++;
+            if (o->area.contains(position))
+            {
+                assert(o->fun);
+                o->fun(args...);
+                count++;
+            }
+        }
+        return count;
+    }
+
+    template <typename... Args>
+    std::int32_t spatial_signal<Args...>::cell_coord(float v) const
+    {
+        // far out positions share the outermost cells, so the cast and the
+        // cell iteration can not overflow
+        constexpr auto limit = double{1 << 30};
+        return static_cast<std::int32_t>(std::clamp(std::floor(double{v} / cell_size), -limit, limit));
+    }
+
+    template <typename... Args>
+    std::uint64_t spatial_signal<Args...>::cell_key(std::int32_t x, std::int32_t y) const
+    {
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32) | static_cast<std::uint32_t>(y);
+    }
+
+    template <typename... Args>
+    typename spatial_signal<Args...>::span spatial_signal<Args...>::cells_of(const box& area) const
+    {
+        return {cell_coord(area.min.x), cell_coord(area.max.x), cell_coord(area.min.y), cell_coord(area.max.y)};
+    }
+
+    template <typename... Args>
+    void spatial_signal<Args...>::insert(const observer& o)
+    {
+        auto by_id = [] (const observer* a, const observer* b) {
+            return a->id < b->id;
+        };
+
+        auto s = cells_of(o.area);
+        if (s.wide())
+        {
+            wide.insert(std::upper_bound(begin(wide), end(wide), &o, by_id), &o);
+            return;
+        }
+
+        for (auto x = s.x0; x <= s.x1; x++)
+        {
+            for (auto y = s.y0; y <= s.y1; y++)
+            {
+                auto& cell = cells[cell_key(static_cast<std::int32_t>(x), static_cast<std::int32_t>(y))];
+                cell.insert(std::upper_bound(begin(cell), end(cell), &o, by_id), &o);
+            }
+        }
+    }
+
+    template <typename... Args>
+    void spatial_signal<Args...>::remove(const observer& o)
+    {
+        auto s = cells_of(o.area);
+        if (s.wide())
+        {
+            wide.erase(std::find(begin(wide), end(wide), &o));
+            return;
+        }
+
+        for (auto x = s.x0; x <= s.x1; x++)
+        {
+            for (auto y = s.y0; y <= s.y1; y++)
+            {
+                auto i = cells.find(cell_key(static_cast<std::int32_t>(x), static_cast<std::int32_t>(y)));
+                assert(i != end(cells));
+                auto& cell = i->second;
+                cell.erase(std::find(begin(cell), end(cell), &o));
+                if (cell.empty())
+                {
+                    cells.erase(i);
+                }
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,242 @@
+//
+// rsig - rioki's signal library
+// Copyright (c) 2020 Sean Farrell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef _RSIG_WHEN_ALL_H_
+#define _RSIG_WHEN_ALL_H_
+
+#include <array>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "rsig.h"
+
+namespace rsig
+{
+    namespace detail
+    {
+        //! The stored arguments of a signal type.
+        template <typename Signal>
+        struct signal_values;
+
+        template <typename... Args>
+        struct signal_values<signal<Args...>>
+        {
+            using type = std::tuple<std::decay_t<Args>...>;
+        };
+
+        //! Lock for short critical sections that never block.
+        class spin_lock
+        {
+        public:
+            void lock() noexcept
+            {
+                while (locked.exchange(true, std::memory_order_acquire))
+                {
+                    while (locked.load(std::memory_order_relaxed))
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+
+            void unlock() noexcept
+            {
+                locked.store(false, std::memory_order_release);
+            }
+
+        private:
+            std::atomic<bool> locked = false;
+        };
+    }
+
+    /*!
+     * Join of several signals.
+     *
+     * Each input stores the arguments of its latest emission and sets its
+     * bit in an atomic mask. The emission that completes the mask starts a
+     * new round and emits the combined values of all inputs, on its own
+     * thread.
+     *
+     * @note An emission that races with the completion of a round counts
+     * for the completed round. The inputs must outlive the join.
+     */
+    template <typename... Inputs>
+    class join
+    {
+    public:
+        //! The combined values, one tuple of arguments per input.
+        using value_type = std::tuple<typename detail::signal_values<Inputs>::type...>;
+
+        /*!
+         * Join signals.
+         *
+         * @param inputs the signals to wait for
+         */
+        explicit join(Inputs&... inputs);
+        ~join();
+
+        /*!
+         * Connect an observer to the join.
+         *
+         * @param fun the lambda function that will be called when all inputs were emitted.
+         * @return the connection for this observer
+         */
+        connection connect(const std::function<void(const value_type&)>& fun);
+
+        /*!
+         * Disconnect an observer.
+         *
+         * @param id the connection returned by connect
+         */
+        void disconnect(connection id);
+
+        //! Forget the inputs that arrived in the current round.
+        void reset() noexcept;
+
+    private:
+        static constexpr size_t count = sizeof...(Inputs);
+        static_assert(count != 0 && count <= 64, "join needs between 1 and 64 inputs");
+
+        static constexpr std::uint64_t all = count == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << count) - 1u;
+
+        std::tuple<Inputs&...>               inputs;
+        std::array<connection, count>        connections;
+        std::atomic<std::uint64_t>           arrived = 0;
+        value_type                           values;
+        std::array<detail::spin_lock, count> locks;
+        signal<const value_type&>            output;
+
+        template <size_t... I>
+        void connect_inputs(std::index_sequence<I...>);
+
+        template <size_t... I>
+        void disconnect_inputs(std::index_sequence<I...>);
+
+        template <size_t I, typename... Args>
+        void arrive(Args&... args);
+
+        template <size_t... I>
+        value_type collect(std::index_sequence<I...>);
+
+        join(const join<Inputs...>&) = delete;
+        join<Inputs...>& operator = (const join<Inputs...>&) = delete;
+    };
+
+    /*!
+     * Join several signals.
+     *
+     * Example:
+     * @code
+     * auto frame = rsig::when_all(physics_done, audio_done, ai_done);
+     * frame.connect([] (const auto& values) { render(std::get<0>(values)); });
+     * @endcode
+     *
+     * @param inputs the signals to wait for
+     * @return the join, connect to it to get the combined values
+     */
+    template <typename... Inputs>
+    join<Inputs...> when_all(Inputs&... inputs)
+    {
+        return join<Inputs...>(inputs...);
+    }
+
+    template <typename... Inputs>
+    join<Inputs...>::join(Inputs&... i)
+    : inputs(i...)
+    {
+        connect_inputs(std::index_sequence_for<Inputs...>{});
+    }
+
+    template <typename... Inputs>
+    join<Inputs...>::~join()
+    {
+        disconnect_inputs(std::index_sequence_for<Inputs...>{});
+    }
+
+    template <typename... Inputs>
+    connection join<Inputs...>::connect(const std::function<void(const value_type&)>& fun)
+    {
+        return output.connect(fun);
+    }
+
+    template <typename... Inputs>
+    void join<Inputs...>::disconnect(connection id)
+    {
+        output.disconnect(id);
+    }
+
+    template <typename... Inputs>
+    void join<Inputs...>::reset() noexcept
+    {
+        arrived.store(0, std::memory_order_release);
+    }
+
+    template <typename... Inputs>
+    template <size_t... I>
+    void join<Inputs...>::connect_inputs(std::index_sequence<I...>)
+    {
+        ((connections[I] = std::get<I>(inputs).connect([this] (auto... args) {
+            arrive<I>(args...);
+        })), ...);
+    }
+
+    template <typename... Inputs>
+    template <size_t... I>
+    void join<Inputs...>::disconnect_inputs(std::index_sequence<I...>)
+    {
+        (std::get<I>(inputs).disconnect(connections[I]), ...);
+    }
+
+    template <typename... Inputs>
+    template <size_t I, typename... Args>
+    void join<Inputs...>::arrive(Args&... args)
+    {
+        {
+            std::scoped_lock<detail::spin_lock> sl(locks[I]);
+            std::get<I>(values) = std::make_tuple(args...);
+        }
+
+        constexpr auto bit = std::uint64_t{1} << I;
+        auto prev = arrived.fetch_or(bit, std::memory_order_acq_rel);
+        if ((prev | bit) == all && prev != all)
+        {
+            // only the emission that completed the mask gets here
+            arrived.store(0, std::memory_order_release);
+            output.emit(collect(std::index_sequence_for<Inputs...>{}));
+        }
+    }
+
+    template <typename... Inputs>
+    template <size_t... I>
+    typename join<Inputs...>::value_type join<Inputs...>::collect(std::index_sequence<I...>)
+    {
+        auto copy = [this] (auto index) {
+            std::scoped_lock<detail::spin_lock> sl(locks[decltype(index)::value]);
+            return std::get<decltype(index)::value>(values);
+        };
+        return value_type{copy(std::integral_constant<size_t, I>{})...};
+    }
+}
+
+#endif